@@ -0,0 +1,156 @@
+/*
+ * Evaluating one expression over many rows of inputs: walking the tree and
+ * running the bytecode once per row, and running it a chunk of rows at a time
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define NUM_ROWS 1000000
+#define NUM_INPUTS 4
+
+static const char *TOK_NUM = "num";
+static const char *TOK_VAR = "var";
+static const char *TOK_ADD = "add";
+static const char *TOK_SUB = "sub";
+static const char *TOK_MUL = "mul";
+static const char *TOK_DIV = "div";
+static const char *TOK_NEG = "neg";
+
+static const size_t SIZES[] = { 7, 31, 127 };
+
+static volatile double sink;
+
+static double walk(struct zz_node *n, const double *row)
+{
+	struct zz_node *a, *b;
+
+	if (n->token == TOK_NUM)
+		return zz_get_double(n);
+	if (n->token == TOK_VAR)
+		return row[zz_get_int(n)];
+	a = zz_first_child(n);
+	if (n->token == TOK_NEG)
+		return -walk(a, row);
+	b = zz_next_sibling(n, a);
+	if (n->token == TOK_ADD)
+		return walk(a, row) + walk(b, row);
+	if (n->token == TOK_SUB)
+		return walk(a, row) - walk(b, row);
+	if (n->token == TOK_MUL)
+		return walk(a, row) * walk(b, row);
+	return walk(a, row) / walk(b, row);
+}
+
+/* Random expression of about ``size`` nodes, over the inputs */
+static struct zz_node *generate(struct zz_tree *tree, size_t size,
+		unsigned int *seed)
+{
+	static const char *const *ops[] = { &TOK_ADD, &TOK_SUB, &TOK_MUL,
+		&TOK_DIV };
+	struct zz_node *n;
+	size_t left;
+
+	*seed = *seed * 1103515245 + 12345;
+	if (size < 3) {
+		if (size == 2) {
+			n = zz_node(tree, TOK_NEG, zz_null);
+			zz_append_child(n, generate(tree, 1, seed));
+			return n;
+		}
+		if ((*seed >> 16) % 3)
+			return zz_leaf(tree, TOK_VAR,
+					zz_int((*seed >> 8) % NUM_INPUTS));
+		return zz_leaf(tree, TOK_NUM,
+				zz_double(0.5 + (*seed >> 8) % 8));
+	}
+	n = zz_node(tree, *ops[(*seed >> 16) % 4], zz_null);
+	left = 1 + (*seed >> 4) % (size - 2);
+	zz_append_child(n, generate(tree, left, seed));
+	zz_append_child(n, generate(tree, size - 1 - left, seed));
+	return n;
+}
+
+static void report(const char *variant, size_t size, double elapsed,
+		const double *out, const double *expected)
+{
+	if (memcmp(out, expected, NUM_ROWS * sizeof(*out)) != 0)
+		fprintf(stderr, "%s: results differ\n", variant);
+	sink = out[NUM_ROWS - 1];
+	bench_report("zz_program_run_batch", variant, size,
+			elapsed * 1e9 / NUM_ROWS, 0);
+}
+
+static void bench(size_t size, double (*columns)[NUM_ROWS], double *out,
+		double *expected)
+{
+	struct zz_program program;
+	struct zz_tree tree;
+	struct zz_node *root;
+	const double *inputs[NUM_INPUTS];
+	double row[NUM_INPUTS], start;
+	unsigned int seed = 42;
+	size_t i, r;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	root = generate(&tree, size, &seed);
+	zz_program_init(&program);
+	zz_program_opcode(&program, TOK_NUM, ZZ_OP_CONST);
+	zz_program_opcode(&program, TOK_VAR, ZZ_OP_INPUT);
+	zz_program_opcode(&program, TOK_ADD, ZZ_OP_ADD);
+	zz_program_opcode(&program, TOK_SUB, ZZ_OP_SUB);
+	zz_program_opcode(&program, TOK_MUL, ZZ_OP_MUL);
+	zz_program_opcode(&program, TOK_DIV, ZZ_OP_DIV);
+	zz_program_opcode(&program, TOK_NEG, ZZ_OP_NEG);
+	zz_program_compile(&program, root);
+	for (i = 0; i < NUM_INPUTS; ++i)
+		inputs[i] = columns[i];
+
+	start = bench_now();
+	for (r = 0; r < NUM_ROWS; ++r) {
+		for (i = 0; i < NUM_INPUTS; ++i)
+			row[i] = columns[i][r];
+		expected[r] = walk(root, row);
+	}
+	report("tree walk per row", size, bench_now() - start, expected,
+			expected);
+
+	start = bench_now();
+	for (r = 0; r < NUM_ROWS; ++r) {
+		for (i = 0; i < NUM_INPUTS; ++i)
+			row[i] = columns[i][r];
+		out[r] = zz_program_run(&program, row);
+	}
+	report("bytecode per row", size, bench_now() - start, out, expected);
+
+	memset(out, 0, NUM_ROWS * sizeof(*out));
+	start = bench_now();
+	zz_program_run_batch(&program, inputs, NUM_ROWS, out);
+	report("bytecode in chunks", size, bench_now() - start, out,
+			expected);
+
+	zz_program_destroy(&program);
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	double (*columns)[NUM_ROWS], *out, *expected;
+	size_t i, r;
+
+	columns = malloc(NUM_INPUTS * sizeof(*columns));
+	out = malloc(NUM_ROWS * sizeof(*out));
+	expected = malloc(NUM_ROWS * sizeof(*expected));
+	for (i = 0; i < NUM_INPUTS; ++i)
+		for (r = 0; r < NUM_ROWS; ++r)
+			columns[i][r] = 1 + (r * (2 * i + 7) % 1000) / 100.0;
+	for (i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); ++i)
+		bench(SIZES[i], columns, out, expected);
+	free(columns);
+	free(out);
+	free(expected);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,46 @@
+/*
+ * Helpers shared by the benchmarks
+ *
+ * Every benchmark prints its results as JSON, one object per line, so that the
+ * output of ``make bench`` can be compared across releases.
+ */
+
+#ifndef ZEBU_BENCH_H_
+#define ZEBU_BENCH_H_
+
+#include <malloc.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/resource.h>
+
+static inline double bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Bytes currently allocated with malloc */
+static inline size_t bench_heap(void)
+{
+	return mallinfo2().uordblks;
+}
+
+/* Peak resident set size of the process, in kilobytes */
+static inline long bench_peak_rss(void)
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+static inline void bench_report(const char *name, const char *variant,
+		size_t size, double ns_per_op, double bytes_per_node)
+{
+	printf("{\"bench\": \"%s\", \"variant\": \"%s\", \"size\": %zu, "
+			"\"ns_per_op\": %.2f, \"bytes_per_node\": %.2f, "
+			"\"peak_rss_kb\": %ld}\n", name, variant, size, ns_per_op,
+			bytes_per_node, bench_peak_rss());
+}
+
+#endif          // ZEBU_BENCH_H_
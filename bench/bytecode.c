@@ -0,0 +1,159 @@
+/*
+ * Evaluating the expressions of the calculator in the usage guide many times,
+ * by walking the tree and by running its compiled bytecode
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+/* Nodes evaluated for every size */
+#define WORK 20000000
+
+static const char *TOK_NUM = "num";
+static const char *TOK_ADD = "add";
+static const char *TOK_SUB = "sub";
+static const char *TOK_MUL = "mul";
+static const char *TOK_DIV = "div";
+static const char *TOK_EXP = "exp";
+static const char *TOK_NEG = "neg";
+
+static const size_t SIZES[] = { 15, 127, 1023, 16383 };
+
+static volatile double sink;
+
+static double power(const double *args, unsigned int arity, void *data)
+{
+	double ret = 1;
+	int i;
+
+	for (i = 0; i < args[1]; ++i)
+		ret *= args[0];
+	return ret;
+}
+
+static double walk(struct zz_node *n)
+{
+	struct zz_node *a, *b;
+	double args[2];
+
+	if (n->token == TOK_NUM)
+		return zz_get_int(n);
+	a = zz_first_child(n);
+	if (n->token == TOK_NEG)
+		return -walk(a);
+	b = zz_next_sibling(n, a);
+	if (n->token == TOK_ADD)
+		return walk(a) + walk(b);
+	if (n->token == TOK_SUB)
+		return walk(a) - walk(b);
+	if (n->token == TOK_MUL)
+		return walk(a) * walk(b);
+	if (n->token == TOK_DIV)
+		return walk(a) / walk(b);
+	args[0] = walk(a);
+	args[1] = walk(b);
+	return power(args, 2, NULL);
+}
+
+/* Random expression of about ``size`` nodes */
+static struct zz_node *generate(struct zz_tree *tree, size_t size,
+		unsigned int *seed)
+{
+	static const char *const *ops[] = { &TOK_ADD, &TOK_SUB, &TOK_MUL,
+		&TOK_DIV, &TOK_ADD, &TOK_SUB, &TOK_MUL, &TOK_EXP };
+	struct zz_node *n;
+	size_t left;
+	int value;
+
+	*seed = *seed * 1103515245 + 12345;
+	if (size < 3) {
+		if (size == 2) {
+			n = zz_node(tree, TOK_NEG, zz_null);
+			zz_append_child(n, generate(tree, 1, seed));
+			return n;
+		}
+		return zz_leaf(tree, TOK_NUM, zz_int(1 + (*seed >> 16) % 9));
+	}
+	n = zz_node(tree, *ops[(*seed >> 16) % 8], zz_null);
+	if (n->token == TOK_ADD || n->token == TOK_SUB) {
+		left = 1 + (*seed >> 4) % (size - 2);
+		zz_append_child(n, generate(tree, left, seed));
+		zz_append_child(n, generate(tree, size - 1 - left, seed));
+		return n;
+	}
+	/* Scale by a small number, or raise to a small power */
+	zz_append_child(n, generate(tree, size - 2, seed));
+	if (n->token == TOK_EXP)
+		value = (*seed >> 8) % 3;
+	else
+		value = 1 + (*seed >> 8) % 3;
+	zz_append_child(n, zz_leaf(tree, TOK_NUM, zz_int(value)));
+	return n;
+}
+
+static void bench(size_t size)
+{
+	struct zz_program program;
+	struct zz_tree tree;
+	struct zz_tree_stats stats;
+	struct zz_node *root;
+	unsigned int seed = 42;
+	size_t i, n, repeat;
+	double start, elapsed, total, walked;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	root = generate(&tree, size, &seed);
+	zz_tree_stats(&tree, &stats);
+	n = stats.nodes;
+	repeat = WORK / n;
+
+	zz_program_init(&program);
+	zz_program_opcode(&program, TOK_NUM, ZZ_OP_CONST);
+	zz_program_opcode(&program, TOK_ADD, ZZ_OP_ADD);
+	zz_program_opcode(&program, TOK_SUB, ZZ_OP_SUB);
+	zz_program_opcode(&program, TOK_MUL, ZZ_OP_MUL);
+	zz_program_opcode(&program, TOK_DIV, ZZ_OP_DIV);
+	zz_program_opcode(&program, TOK_NEG, ZZ_OP_NEG);
+	zz_program_function(&program, TOK_EXP, power, NULL);
+
+	start = bench_now();
+	for (i = 0; i < repeat; ++i)
+		zz_program_compile(&program, root);
+	elapsed = bench_now() - start;
+	bench_report("zz_program", "compile", n, elapsed * 1e9 / repeat / n, 0);
+
+	total = 0;
+	start = bench_now();
+	for (i = 0; i < repeat; ++i)
+		total += walk(root);
+	elapsed = bench_now() - start;
+	walked = total;
+	bench_report("zz_program", "tree walk", n, elapsed * 1e9 / repeat / n,
+			0);
+
+	total = 0;
+	start = bench_now();
+	for (i = 0; i < repeat; ++i)
+		total += zz_program_run(&program, NULL);
+	elapsed = bench_now() - start;
+	sink = total;
+	if (memcmp(&total, &walked, sizeof(total)) != 0)
+		fprintf(stderr, "results differ\n");
+	bench_report("zz_program", "bytecode", n, elapsed * 1e9 / repeat / n,
+			0);
+
+	zz_program_destroy(&program);
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); ++i)
+		bench(SIZES[i]);
+	exit(EXIT_SUCCESS);
+}
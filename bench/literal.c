@@ -0,0 +1,107 @@
+/*
+ * Parsing of numeric literals, compared with the C library
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define NUM_LITERALS 1000000
+
+struct literals {
+	char *text;
+	size_t *offsets;
+	size_t *lengths;
+};
+
+static void generate(struct literals *l, int doubles)
+{
+	char buf[64];
+	size_t i, used = 0;
+	int len;
+
+	l->text = malloc(NUM_LITERALS * 32);
+	l->offsets = malloc(NUM_LITERALS * sizeof(*l->offsets));
+	l->lengths = malloc(NUM_LITERALS * sizeof(*l->lengths));
+	srand(42);
+	for (i = 0; i < NUM_LITERALS; ++i) {
+		if (!doubles)
+			len = snprintf(buf, sizeof(buf), "%d", rand() >> (i % 24));
+		else if (i % 4 == 0)
+			len = snprintf(buf, sizeof(buf), "%.17g",
+					(double)rand() / RAND_MAX);
+		else
+			len = snprintf(buf, sizeof(buf), "%d.%0*d",
+					rand() % 10000, (int)(i % 6) + 1,
+					rand() % 100000);
+		memcpy(l->text + used, buf, len + 1);
+		l->offsets[i] = used;
+		l->lengths[i] = len;
+		used += len + 1;
+	}
+}
+
+static void destroy(struct literals *l)
+{
+	free(l->text);
+	free(l->offsets);
+	free(l->lengths);
+}
+
+static void report(const char *name, const char *variant, double start,
+		double sum)
+{
+	double elapsed = bench_now() - start;
+
+	/* Keep the sum alive so that the loop isn't optimized away */
+	if (sum == 42.4242)
+		printf("\n");
+	bench_report(name, variant, NUM_LITERALS, elapsed * 1e9 / NUM_LITERALS,
+			0);
+}
+
+int main(int argc, char *argv[])
+{
+	struct literals l;
+	struct zz_data data;
+	double start, sum;
+	size_t i;
+
+	generate(&l, 0);
+	sum = 0;
+	start = bench_now();
+	for (i = 0; i < NUM_LITERALS; ++i) {
+		zz_parse_int(l.text + l.offsets[i], l.lengths[i], &data);
+		sum += zz_to_int(data);
+	}
+	report("parse_int", "zz_parse_int", start, sum);
+	sum = 0;
+	start = bench_now();
+	for (i = 0; i < NUM_LITERALS; ++i) {
+		data = zz_int(strtol(l.text + l.offsets[i], NULL, 0));
+		sum += zz_to_int(data);
+	}
+	report("parse_int", "strtol", start, sum);
+	destroy(&l);
+
+	generate(&l, 1);
+	sum = 0;
+	start = bench_now();
+	for (i = 0; i < NUM_LITERALS; ++i) {
+		zz_parse_double(l.text + l.offsets[i], l.lengths[i], &data);
+		sum += zz_to_double(data);
+	}
+	report("parse_double", "zz_parse_double", start, sum);
+	sum = 0;
+	start = bench_now();
+	for (i = 0; i < NUM_LITERALS; ++i) {
+		data = zz_double(strtod(l.text + l.offsets[i], NULL));
+		sum += zz_to_double(data);
+	}
+	report("parse_double", "strtod", start, sum);
+	destroy(&l);
+
+	exit(EXIT_SUCCESS);
+}
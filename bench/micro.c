@@ -0,0 +1,399 @@
+/*
+ * Microbenchmarks for the basic operations on trees
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+
+static const size_t SIZES[] = { 1000, 10000, 100000, 1000000 };
+
+static volatile long sink;
+
+/* Build a tree of ``size`` nodes with 8 children per internal node and
+ * ``distinct`` different strings in the leaves */
+static struct zz_node *build(struct zz_tree *tree, size_t size, size_t distinct)
+{
+	struct zz_node **nodes, *root;
+	char buf[32];
+	size_t i;
+
+	nodes = calloc(size, sizeof(*nodes));
+	for (i = 0; i < size; ++i) {
+		if (i % 2) {
+			snprintf(buf, sizeof(buf), "id%zu", i % distinct);
+			nodes[i] = zz_node(tree, TOK_BAR, zz_string(buf));
+		} else {
+			nodes[i] = zz_node(tree, TOK_FOO, zz_int(i));
+		}
+		if (i > 0)
+			zz_append_child(nodes[(i - 1) / 8], nodes[i]);
+	}
+	root = nodes[0];
+	free(nodes);
+	return root;
+}
+
+static void bench_node(size_t size)
+{
+	struct zz_tree tree;
+	size_t i, heap;
+	double start, elapsed;
+
+	heap = bench_heap();
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	start = bench_now();
+	for (i = 0; i < size; ++i)
+		zz_node(&tree, TOK_FOO, zz_int(i));
+	elapsed = bench_now() - start;
+	bench_report("zz_node", "int", size, elapsed * 1e9 / size,
+			(double)(bench_heap() - heap) / size);
+	zz_tree_destroy(&tree);
+}
+
+/* Same workload as tests/alloc.c: one node per number, as a string, interned
+ * or stored inline */
+static void bench_node_string(size_t size,
+		struct zz_data (*string)(const char *), const char *variant)
+{
+	struct zz_tree tree;
+	char buf[16];
+	size_t i, heap;
+	double start, elapsed;
+
+	heap = bench_heap();
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	start = bench_now();
+	for (i = 0; i < size; ++i) {
+		snprintf(buf, sizeof(buf), "%zu", i);
+		zz_node(&tree, TOK_BAR, string(buf));
+	}
+	elapsed = bench_now() - start;
+	bench_report("zz_node", variant, size, elapsed * 1e9 / size,
+			(double)(bench_heap() - heap) / size);
+	zz_tree_destroy(&tree);
+}
+
+/* One node in 16 carries 128 bytes of user fields, either with a node size
+ * for its token or by making every node that large */
+static void bench_node_sizes(size_t size, int per_token)
+{
+	struct zz_tree tree;
+	size_t i, heap;
+	double start, elapsed;
+
+	heap = bench_heap();
+	if (per_token) {
+		zz_tree_init(&tree, sizeof(struct zz_node));
+		zz_tree_set_token_size(&tree, TOK_FOO,
+				sizeof(struct zz_node) + 128);
+	} else {
+		zz_tree_init(&tree, sizeof(struct zz_node) + 128);
+	}
+	start = bench_now();
+	for (i = 0; i < size; ++i)
+		zz_node(&tree, i % 16 ? TOK_BAR : TOK_FOO, zz_int(i));
+	elapsed = bench_now() - start;
+	bench_report("zz_node", per_token ? "heavy 1/16, per token" :
+			"heavy 1/16, uniform", size, elapsed * 1e9 / size,
+			(double)(bench_heap() - heap) / size);
+	zz_tree_destroy(&tree);
+}
+
+/* Sum the integers in the subtree of ``node`` */
+static long sum(struct zz_node *node)
+{
+	struct zz_node *iter;
+	long ret = 0;
+
+	if (zz_is_int(node))
+		ret = zz_get_int(node);
+	zz_foreach_child(iter, node)
+		ret += sum(iter);
+	return ret;
+}
+
+/* Build a binary expression of ``size`` nodes, half of them operands */
+static void bench_expr(size_t size, int leaves)
+{
+	struct zz_tree tree;
+	struct zz_node **nodes;
+	size_t i, heap;
+	double start, elapsed;
+
+	nodes = calloc(size, sizeof(*nodes));
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	heap = bench_heap();
+	start = bench_now();
+	for (i = 0; i < size; ++i) {
+		if (i < size / 2)
+			nodes[i] = zz_node(&tree, TOK_FOO, zz_null);
+		else if (leaves)
+			nodes[i] = zz_leaf(&tree, TOK_BAR, zz_int(i));
+		else
+			nodes[i] = zz_node(&tree, TOK_BAR, zz_int(i));
+		if (i > 0)
+			zz_append_child(nodes[(i - 1) / 2], nodes[i]);
+	}
+	elapsed = bench_now() - start;
+	bench_report("zz_leaf", leaves ? "expression, leaves" :
+			"expression, nodes", size, elapsed * 1e9 / size,
+			(double)(bench_heap() - heap) / size);
+	start = bench_now();
+	sink = sum(nodes[0]);
+	elapsed = bench_now() - start;
+	bench_report("zz_foreach_child", leaves ? "expression, leaves" :
+			"expression, nodes", size, elapsed * 1e9 / size, 0);
+	zz_tree_destroy(&tree);
+	free(nodes);
+}
+
+/* Attach an attribute to every node of a tree in a column, and read it back */
+static void bench_column(size_t size)
+{
+	struct zz_tree tree;
+	struct zz_column column;
+	struct zz_node *n;
+	size_t heap;
+	double start, elapsed;
+	long total;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	build(&tree, size, size / 16 + 1);
+	heap = bench_heap();
+	start = bench_now();
+	zz_column_init(&column, sizeof(long), NULL);
+	zz_list_foreach_entry(n, &tree.nodes, allocated)
+		zz_column_ref(&column, n, long) = (long)n->id;
+	total = 0;
+	zz_list_foreach_entry(n, &tree.nodes, allocated)
+		total += zz_column_ref(&column, n, long);
+	elapsed = bench_now() - start;
+	sink = total;
+	bench_report("zz_column", "set and get", size, elapsed * 1e9 / size,
+			(double)(bench_heap() - heap) / size);
+	zz_column_destroy(&column);
+	zz_tree_destroy(&tree);
+}
+
+/* Count the nodes of a token by walking the tree */
+static size_t count_token(struct zz_node *node, const char *token)
+{
+	struct zz_node *iter;
+	size_t ret = node->token == token;
+
+	zz_foreach_child(iter, node)
+		ret += count_token(iter, token);
+	return ret;
+}
+
+/* Find the nodes of a token that is rare in the tree */
+static void bench_index(size_t size, int indexed)
+{
+	struct zz_tree tree;
+	struct zz_node *root, **nodes;
+	size_t i, j, count, reps;
+	double start, elapsed;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_set_indexed(&tree, indexed);
+	root = build(&tree, size, size / 16 + 1);
+	for (i = 0; i < size / 64 + 1; ++i)
+		zz_append_child(root, zz_leaf(&tree, "rare", zz_null));
+	reps = 100;
+	count = 0;
+	start = bench_now();
+	for (i = 0; i < reps; ++i) {
+		if (indexed) {
+			nodes = zz_tree_token_nodes(&tree, "rare", &j);
+			for (count = 0; j > 0; --j)
+				count += nodes[j - 1]->token != NULL;
+		} else {
+			count = count_token(root, "rare");
+		}
+	}
+	elapsed = bench_now() - start;
+	sink = count;
+	bench_report("zz_tree_token_nodes", indexed ? "index" : "walk", size,
+			elapsed * 1e9 / reps, 0);
+	zz_tree_destroy(&tree);
+}
+
+/* Number a tree, then check random pairs of nodes for ancestry */
+static void bench_order(size_t size)
+{
+	struct zz_tree tree;
+	struct zz_order order;
+	struct zz_node **nodes, *n;
+	size_t i, heap, reps;
+	unsigned int seed = 1;
+	double start, elapsed;
+	long total;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	build(&tree, size, size / 16 + 1);
+	nodes = malloc(size * sizeof(*nodes));
+	i = 0;
+	zz_list_foreach_entry(n, &tree.nodes, allocated)
+		nodes[i++] = n;
+	heap = bench_heap();
+	start = bench_now();
+	zz_order_init(&order, NULL);
+	zz_order_build(&order, nodes[0]);
+	elapsed = bench_now() - start;
+	bench_report("zz_order_build", "tree", size, elapsed * 1e9 / size,
+			(double)(bench_heap() - heap) / size);
+	reps = 1000000;
+	total = 0;
+	start = bench_now();
+	for (i = 0; i < reps; ++i) {
+		seed = seed * 1103515245 + 12345;
+		total += zz_is_ancestor(&order, nodes[(seed >> 4) % size],
+				nodes[(seed >> 12) % size]);
+	}
+	elapsed = bench_now() - start;
+	sink = total;
+	bench_report("zz_is_ancestor", "random pairs", size,
+			elapsed * 1e9 / reps, 0);
+	zz_order_destroy(&order);
+	zz_tree_destroy(&tree);
+	free(nodes);
+}
+
+static void bench_string(size_t size, size_t distinct, const char *variant)
+{
+	struct zz_data *data;
+	char buf[32];
+	size_t i, heap;
+	double start, elapsed;
+
+	data = calloc(size, sizeof(*data));
+	heap = bench_heap();
+	start = bench_now();
+	for (i = 0; i < size; ++i) {
+		/* Longer than ZZ_SHORT_STRING_MAX */
+		snprintf(buf, sizeof(buf), "interned string %zu", i % distinct);
+		data[i] = zz_string(buf);
+	}
+	elapsed = bench_now() - start;
+	bench_report("zz_string", variant, size, elapsed * 1e9 / size,
+			(double)(bench_heap() - heap) / size);
+	for (i = 0; i < size; ++i)
+		zz_data_destroy(data[i]);
+	free(data);
+}
+
+static void bench_copy(size_t size)
+{
+	struct zz_tree tree, copy;
+	struct zz_node *root;
+	size_t heap;
+	double start, elapsed;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	root = build(&tree, size, size / 16 + 1);
+	zz_tree_init(&copy, sizeof(struct zz_node));
+	heap = bench_heap();
+	start = bench_now();
+	zz_copy_recursive(&copy, root);
+	elapsed = bench_now() - start;
+	bench_report("zz_copy_recursive", "tree", size, elapsed * 1e9 / size,
+			(double)(bench_heap() - heap) / size);
+	zz_tree_destroy(&copy);
+	zz_tree_destroy(&tree);
+}
+
+static void bench_print(size_t size)
+{
+	struct zz_tree tree;
+	struct zz_node *root;
+	FILE *f;
+	double start, elapsed;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	root = build(&tree, size, size / 16 + 1);
+	f = fopen("/dev/null", "w");
+	start = bench_now();
+	zz_print(root, f);
+	elapsed = bench_now() - start;
+	fclose(f);
+	bench_report("zz_print", "tree", size, elapsed * 1e9 / size, 0);
+	zz_tree_destroy(&tree);
+}
+
+static void bench_destroy(size_t size)
+{
+	struct zz_tree tree;
+	double start, elapsed;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	build(&tree, size, size / 16 + 1);
+	start = bench_now();
+	zz_tree_destroy(&tree);
+	elapsed = bench_now() - start;
+	bench_report("zz_tree_destroy", "tree", size, elapsed * 1e9 / size, 0);
+}
+
+/* Report an error on the last line of a file of ``size`` lines */
+static void bench_error(size_t size)
+{
+	static const char path[] = "micro.error.tmp";
+	FILE *f;
+	size_t i, reps;
+	double start, elapsed;
+	int fd, null;
+
+	f = fopen(path, "w");
+	for (i = 0; i < size; ++i)
+		fprintf(f, "line %zu: some source text to skip over\n", i);
+	fclose(f);
+
+	reps = 10;
+	fflush(stderr);
+	fd = dup(STDERR_FILENO);
+	null = open("/dev/null", O_WRONLY);
+	dup2(null, STDERR_FILENO);
+	start = bench_now();
+	for (i = 0; i < reps; ++i)
+		zz_error("error", path, size, 1, size, 4);
+	elapsed = bench_now() - start;
+	fflush(stderr);
+	dup2(fd, STDERR_FILENO);
+	close(null);
+	close(fd);
+	bench_report("zz_error", "last line", size, elapsed * 1e9 / reps, 0);
+	remove(path);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t i, size;
+
+	for (i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); ++i) {
+		size = SIZES[i];
+		bench_node(size);
+		bench_node_string(size, zz_string, "number string");
+		bench_node_string(size, zz_short_string, "number short string");
+		bench_node_sizes(size, 0);
+		bench_node_sizes(size, 1);
+		bench_expr(size, 0);
+		bench_expr(size, 1);
+		bench_column(size);
+		bench_index(size, 0);
+		bench_index(size, 1);
+		bench_order(size);
+		bench_string(size, size, "unique");
+		bench_string(size, 16, "duplicate");
+		bench_copy(size);
+		bench_print(size);
+		bench_error(size);
+		bench_destroy(size);
+	}
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,113 @@
+/*
+ * Matching a set of patterns against an expression tree, all at once and one
+ * pattern at a time
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define NUM_NODES 1000000
+
+static const char *TOK_ADD = "add";
+static const char *TOK_SUB = "sub";
+static const char *TOK_MUL = "mul";
+static const char *TOK_NUM = "num";
+static const char *TOK_ID = "id";
+
+static const char *const PATTERNS[] = {
+	"[add [num 0] x]",
+	"[add x [num 0]]",
+	"[add x x]",
+	"[sub x x]",
+	"[sub x [num 0]]",
+	"[mul [num 0] _]",
+	"[mul _ [num 0]]",
+	"[mul [num 1] x]",
+	"[mul x [num 1]]",
+	"[mul [num 2] x]",
+	"[add [mul x y] [mul x z]]",
+	"[sub [num 0] x]",
+	"[add [id \"i\"] [num 1]]",
+	"[mul [add x y] [num 0]]",
+	"[_ [num] [num]]",
+	"[sub [add x y] y]",
+};
+
+#define NUM_PATTERNS (sizeof(PATTERNS) / sizeof(PATTERNS[0]))
+
+/* Random expression of about ``size`` nodes, with small constants and a few
+ * identifiers */
+static struct zz_node *generate(struct zz_tree *tree, size_t size,
+		unsigned int *seed)
+{
+	static const char *const *ops[] = { &TOK_ADD, &TOK_SUB, &TOK_MUL };
+	static const char *const ids[] = { "i", "j", "k" };
+	struct zz_node *n;
+	size_t left;
+
+	*seed = *seed * 1103515245 + 12345;
+	if (size < 3) {
+		if ((*seed >> 16) % 2)
+			return zz_leaf(tree, TOK_NUM, zz_int((*seed >> 8) % 3));
+		return zz_leaf(tree, TOK_ID,
+				zz_string(ids[(*seed >> 8) % 3]));
+	}
+	n = zz_node(tree, *ops[(*seed >> 16) % 3], zz_null);
+	left = 1 + (*seed >> 4) % (size - 2);
+	zz_append_child(n, generate(tree, left, seed));
+	zz_append_child(n, generate(tree, size - 1 - left, seed));
+	return n;
+}
+
+static int count(struct zz_node *node, const struct zz_match *match,
+		void *data)
+{
+	++*(size_t *)data;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *tokens[] = { TOK_ADD, TOK_SUB, TOK_MUL, TOK_NUM, TOK_ID };
+	struct zz_patterns all, one[NUM_PATTERNS];
+	struct zz_tree tree;
+	struct zz_node *root;
+	unsigned int seed = 42;
+	size_t i, matches, single;
+	double start, elapsed;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	root = generate(&tree, NUM_NODES, &seed);
+	zz_patterns_init(&all, tokens, 5);
+	for (i = 0; i < NUM_PATTERNS; ++i) {
+		zz_pattern_add(&all, PATTERNS[i]);
+		zz_patterns_init(&one[i], tokens, 5);
+		zz_pattern_add(&one[i], PATTERNS[i]);
+	}
+
+	single = 0;
+	start = bench_now();
+	for (i = 0; i < NUM_PATTERNS; ++i)
+		zz_match_tree(&one[i], root, count, &single);
+	elapsed = bench_now() - start;
+	bench_report("zz_match_tree", "one walk per pattern", NUM_NODES,
+			elapsed * 1e9 / NUM_NODES, 0);
+
+	matches = 0;
+	start = bench_now();
+	zz_match_tree(&all, root, count, &matches);
+	elapsed = bench_now() - start;
+	bench_report("zz_match_tree", "all patterns at once", NUM_NODES,
+			elapsed * 1e9 / NUM_NODES, 0);
+	if (matches != single)
+		printf("mismatch: %zu != %zu\n", matches, single);
+
+	for (i = 0; i < NUM_PATTERNS; ++i)
+		zz_patterns_destroy(&one[i]);
+	zz_patterns_destroy(&all);
+	zz_tree_destroy(&tree);
+	exit(EXIT_SUCCESS);
+}
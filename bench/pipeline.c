@@ -0,0 +1,82 @@
+/*
+ * Throughput of a pipeline from one producer to a growing number of workers
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+static const char *TOK_NUM = "num";
+static const char *TOK_ADD = "add";
+static const char *TOK_MUL = "mul";
+
+static const size_t NUM_SUBTREES = 200000;
+static const int DEPTH = 5;
+
+static struct zz_node *build(struct zz_tree *tree, int depth, int seed)
+{
+	struct zz_node *n;
+
+	if (depth == 0)
+		return zz_node(tree, TOK_NUM, zz_int(seed));
+	n = zz_node(tree, seed % 2 ? TOK_ADD : TOK_MUL, zz_null);
+	zz_append_child(n, build(tree, depth - 1, seed * 3 + 1));
+	zz_append_child(n, build(tree, depth - 1, seed * 7 + 2));
+	return n;
+}
+
+static long evaluate(struct zz_node *n)
+{
+	struct zz_node *iter;
+	long val;
+
+	if (n->token == TOK_NUM)
+		return zz_get_int(n);
+	val = n->token == TOK_ADD ? 0 : 1;
+	zz_foreach_child(iter, n) {
+		if (n->token == TOK_ADD)
+			val += evaluate(iter);
+		else
+			val = (val * evaluate(iter)) % 1000003;
+	}
+	return val;
+}
+
+static void visit(struct zz_node *n, void *data)
+{
+	long *sum = data;
+	__sync_fetch_and_add(sum, evaluate(n));
+}
+
+int main(int argc, char *argv[])
+{
+	static const size_t workers[] = { 1, 2, 4, 8, 16 };
+	struct zz_tree tree;
+	struct zz_pipeline pipeline;
+	struct zz_node *root;
+	size_t i, j;
+	double start, elapsed;
+	long sum;
+	char variant[32];
+
+	for (i = 0; i < sizeof(workers) / sizeof(workers[0]); ++i) {
+		zz_tree_init(&tree, sizeof(struct zz_node));
+		root = zz_node(&tree, TOK_ADD, zz_null);
+		sum = 0;
+		start = bench_now();
+		zz_pipeline_init(&pipeline, &tree, workers[i], 64, visit, &sum);
+		for (j = 0; j < NUM_SUBTREES; ++j) {
+			struct zz_node *n = build(&tree, DEPTH, j);
+			zz_append_child(root, n);
+			zz_pipeline_submit(&pipeline, n);
+		}
+		zz_pipeline_destroy(&pipeline);
+		elapsed = bench_now() - start;
+		snprintf(variant, sizeof(variant), "workers=%zu", workers[i]);
+		bench_report("zz_pipeline", variant, NUM_SUBTREES,
+				elapsed * 1e9 / NUM_SUBTREES, 0);
+		zz_tree_destroy(&tree);
+	}
+	exit(EXIT_SUCCESS);
+}
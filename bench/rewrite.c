@@ -0,0 +1,187 @@
+/*
+ * Constant folding of an expression tree with the rewrite engine, compared
+ * with rescanning the whole tree until nothing changes
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+static const char *TOK_ADD = "add";
+static const char *TOK_SUB = "sub";
+static const char *TOK_MUL = "mul";
+static const char *TOK_NUM = "num";
+static const char *TOK_ID = "id";
+
+static const size_t SIZES[] = { 1000, 10000, 100000, 1000000 };
+
+/* Random expression of about ``size`` nodes, mostly constants */
+static struct zz_node *generate(struct zz_tree *tree, size_t size,
+		unsigned int *seed)
+{
+	static const char *const *ops[] = { &TOK_ADD, &TOK_SUB, &TOK_MUL };
+	struct zz_node *n;
+	size_t left;
+
+	*seed = *seed * 1103515245 + 12345;
+	if (size < 3) {
+		if ((*seed >> 16) % 8)
+			return zz_leaf(tree, TOK_NUM, zz_int((*seed >> 8) % 3));
+		return zz_leaf(tree, TOK_ID, zz_string("x"));
+	}
+	n = zz_node(tree, *ops[(*seed >> 16) % 3], zz_null);
+	left = 1 + (*seed >> 4) % (size - 2);
+	zz_append_child(n, generate(tree, left, seed));
+	zz_append_child(n, generate(tree, size - 1 - left, seed));
+	return n;
+}
+
+static struct zz_node *fold(struct zz_tree *tree, struct zz_node *node,
+		const struct zz_match *match, void *data)
+{
+	int a = zz_get_int(zz_first_child(node));
+	int b = zz_get_int(zz_last_child(node));
+	int value;
+
+	if (node->token == TOK_ADD)
+		value = a + b;
+	else if (node->token == TOK_SUB)
+		value = a - b;
+	else
+		value = a * b;
+	return zz_leaf(tree, TOK_NUM, zz_int(value % 1000));
+}
+
+static struct zz_node *identity(struct zz_tree *tree, struct zz_node *node,
+		const struct zz_match *match, void *data)
+{
+	return match->bindings[0];
+}
+
+static struct zz_node *zero(struct zz_tree *tree, struct zz_node *node,
+		const struct zz_match *match, void *data)
+{
+	return zz_leaf(tree, TOK_NUM, zz_int(0));
+}
+
+static void add_rules(struct zz_rewriter *rw)
+{
+	zz_rewrite_rule(rw, "[_ [num] [num]]", fold, NULL);
+	zz_rewrite_rule(rw, "[add x [num 0]]", identity, NULL);
+	zz_rewrite_rule(rw, "[add [num 0] x]", identity, NULL);
+	zz_rewrite_rule(rw, "[sub x [num 0]]", identity, NULL);
+	zz_rewrite_rule(rw, "[mul x [num 1]]", identity, NULL);
+	zz_rewrite_rule(rw, "[mul [num 1] x]", identity, NULL);
+	zz_rewrite_rule(rw, "[mul _ [num 0]]", zero, NULL);
+	zz_rewrite_rule(rw, "[mul [num 0] _]", zero, NULL);
+	zz_rewrite_rule(rw, "[sub x x]", zero, NULL);
+}
+
+/* First rule that matches a node, as an ad-hoc pass would find it */
+struct first {
+	unsigned int pattern;
+	struct zz_node *binding;
+	int found;
+};
+
+static int first_match(struct zz_node *node, const struct zz_match *m,
+		void *data)
+{
+	struct first *f = data;
+
+	if (!f->found || m->pattern < f->pattern) {
+		f->pattern = m->pattern;
+		f->binding = m->num_bindings ? m->bindings[0] : NULL;
+		f->found = 1;
+	}
+	return 0;
+}
+
+/* One pass that applies at most one rule per node, top-down */
+static int rescan(struct zz_rewriter *rw, struct zz_tree *tree,
+		struct zz_node **node)
+{
+	struct zz_node *iter, *ret;
+	struct zz_match match;
+	struct first f = { 0, NULL, 0 };
+	int changed = 0;
+
+	zz_match(&rw->patterns, *node, first_match, &f);
+	if (f.found) {
+		match.pattern = f.pattern;
+		match.bindings = &f.binding;
+		match.num_bindings = f.binding != NULL;
+		ret = rw->rules[f.pattern].build(tree, *node, &match, NULL);
+		zz_take(ret);
+		zz_list_insert(&(*node)->siblings, &ret->siblings);
+		zz_unlink_child(*node);
+		zz_recycle(tree, *node);
+		*node = ret;
+		return 1;
+	}
+	for (iter = zz_first_child(*node); iter != NULL;
+			iter = zz_next_sibling(*node, iter))
+		changed |= rescan(rw, tree, &iter);
+	return changed;
+}
+
+/* Left-leaning sum 1 + 1 + ... + 1, that folds from the bottom up */
+static struct zz_node *chain(struct zz_tree *tree, size_t size)
+{
+	struct zz_node *root, *n;
+	size_t i;
+
+	root = zz_leaf(tree, TOK_NUM, zz_int(1));
+	for (i = 0; i < size / 2; ++i) {
+		n = zz_node(tree, TOK_ADD, zz_null);
+		zz_append_child(n, root);
+		zz_append_child(n, zz_leaf(tree, TOK_NUM, zz_int(1)));
+		root = n;
+	}
+	return root;
+}
+
+static void bench(size_t size, int engine, int deep)
+{
+	struct zz_rewriter rw;
+	struct zz_tree tree;
+	struct zz_node *root;
+	unsigned int seed = 42;
+	double start, elapsed;
+	char variant[64];
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	root = deep ? chain(&tree, size) : generate(&tree, size, &seed);
+	zz_rewriter_init(&rw, (const char *[]){ TOK_ADD, TOK_SUB, TOK_MUL,
+			TOK_NUM, TOK_ID }, 5);
+	add_rules(&rw);
+	start = bench_now();
+	if (engine)
+		root = zz_rewrite(&rw, &tree, root);
+	else
+		while (rescan(&rw, &tree, &root))
+			continue;
+	elapsed = bench_now() - start;
+	snprintf(variant, sizeof(variant), "%s, %s", deep ? "chain" : "random",
+			engine ? "bottom-up" : "rescan until fixpoint");
+	bench_report("zz_rewrite", variant, size, elapsed * 1e9 / size, 0);
+	zz_rewriter_destroy(&rw);
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); ++i) {
+		bench(SIZES[i], 0, 0);
+		bench(SIZES[i], 1, 0);
+		/* Rescanning a chain is quadratic */
+		if (SIZES[i] <= 10000)
+			bench(SIZES[i], 0, 1);
+		bench(SIZES[i], 1, 1);
+	}
+	exit(EXIT_SUCCESS);
+}
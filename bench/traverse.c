@@ -0,0 +1,87 @@
+/*
+ * Scaling of parallel traversal on a wide and a deep tree
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+
+static struct zz_node *build_wide(struct zz_tree *tree, size_t width)
+{
+	struct zz_node *root, *n;
+	size_t i, j;
+
+	root = zz_node(tree, TOK_FOO, zz_int(0));
+	for (i = 0; i < width; ++i) {
+		n = zz_node(tree, TOK_FOO, zz_int(i));
+		for (j = 0; j < 16; ++j)
+			zz_append_child(n, zz_node(tree, TOK_BAR, zz_int(j)));
+		zz_append_child(root, n);
+	}
+	return root;
+}
+
+static struct zz_node *build_deep(struct zz_tree *tree, int depth)
+{
+	struct zz_node *n;
+
+	n = zz_node(tree, depth ? TOK_FOO : TOK_BAR, zz_int(depth));
+	if (depth > 0) {
+		zz_append_child(n, build_deep(tree, depth - 1));
+		zz_append_child(n, build_deep(tree, depth - 1));
+	}
+	return n;
+}
+
+static void accumulate(struct zz_node *n, void *acc, void *data)
+{
+	unsigned long *h = acc;
+	int i;
+
+	for (i = 0; i < 64; ++i)
+		*h = *h * 31 + zz_get_int(n) + i;
+}
+
+static void merge(void *dst, const void *src, void *data)
+{
+	*(unsigned long *)dst += *(const unsigned long *)src;
+}
+
+static void run(const char *name, struct zz_node *root, size_t num_nodes)
+{
+	static const size_t threads[] = { 1, 2, 4, 8, 16 };
+	unsigned long h;
+	double start, elapsed;
+	size_t i;
+	char variant[32];
+
+	for (i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+		h = 0;
+		start = bench_now();
+		zz_parallel_reduce(root, threads[i], sizeof(h), &h, accumulate,
+				merge, NULL);
+		elapsed = bench_now() - start;
+		snprintf(variant, sizeof(variant), "%s,threads=%zu", name,
+				threads[i]);
+		bench_report("zz_parallel_reduce", variant, num_nodes,
+				elapsed * 1e9 / num_nodes, 0);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	run("wide", build_wide(&tree, 1 << 16), (1 << 16) * 17 + 1);
+	zz_tree_destroy(&tree);
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	run("deep", build_deep(&tree, 20), (1 << 21) - 1);
+	zz_tree_destroy(&tree);
+	exit(EXIT_SUCCESS);
+}
@@ -14,14 +14,51 @@ CFLAGS = -g -Werror -Wfatal-errors
 
 LDFLAGS =
 
+# Build variant: debug, release, lto, pgo-generate or pgo-use. All but debug
+# compile the library with optimizations and without assertions; lto and
+# pgo-use also keep LTO bytecode in the objects, so that programs linked with
+# -flto against the static library can inline its functions.
+BUILD = debug
+
+ifeq ($(BUILD),release)
+OPTFLAGS = -O2
+endif
+ifeq ($(BUILD),lto)
+OPTFLAGS = -O2 -flto=auto -ffat-lto-objects
+AR = gcc-ar
+endif
+ifeq ($(BUILD),pgo-generate)
+OPTFLAGS = -O2 -fprofile-generate -fprofile-update=atomic
+endif
+ifeq ($(BUILD),pgo-use)
+OPTFLAGS = -O2 -flto=auto -ffat-lto-objects -fprofile-use \
+	   -fprofile-partial-training -Wno-missing-profile
+AR = gcc-ar
+endif
+
+# Set to 1 to NaN-box node data into 8 bytes; programs using the library must
+# then be compiled with -DZZ_COMPACT_DATA as well.
+COMPACT_DATA = 0
+
+ifeq ($(COMPACT_DATA),1)
+CPPFLAGS += -DZZ_COMPACT_DATA
+endif
+
 ALL_CFLAGS = $(CPPFLAGS) $(CFLAGS)
 ALL_LDFLAGS = $(LDFLAGS)
 
 ALL_CFLAGS += -std=gnu99
 ALL_CFLAGS += -fPIC
+ALL_CFLAGS += -pthread
+
+ALL_LDFLAGS += -pthread
+
+ALL_CFLAGS += $(OPTFLAGS)
+ALL_LDFLAGS += $(OPTFLAGS)
 
 QUIET_CC = @echo CC $@;
 QUIET_LINK = @echo LINK $@;
+QUIET_AR = @echo AR $@;
 QUIET_INSTALL = @echo INSTALL $@;
 QUIET_GEN = @echo GEN $@;
 
@@ -34,7 +71,7 @@ QUIET_GEN = @echo GEN $@;
 	$(QUIET_CC)$(CC) $(ALL_CFLAGS) -c $<
 
 lib%.so:
-	$(QUIET_LINK)$(CC) -shared -Wl,-soname,$@.$(version) -o $@ $^
+	$(QUIET_LINK)$(CC) -shared $(ALL_LDFLAGS) -Wl,-soname,$@.$(version) -o $@ $^
 
 lib%.a:
 	$(QUIET_AR)$(AR) rcs $@ $^
@@ -0,0 +1,76 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_ALLOC_H_
+#define ZEBU_ALLOC_H_
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Allocator
+ * ---------
+ *
+ * Memory for nodes and strings can be taken from a user-provided allocator
+ * instead of the C library. A ``NULL`` allocator stands for malloc(),
+ * realloc() and free(), and is checked for before every call, so the default
+ * costs one branch and no indirect call.
+ *
+ * Every function gets the ``ctx`` pointer of the allocator as its first
+ * argument; ``free`` and ``realloc`` also get the size of the block, as passed
+ * when it was allocated.
+ */
+
+/**
+ * Allocator functions and their context
+ */
+struct zz_allocator {
+	void *(*alloc)(void *ctx, size_t size);
+	void *(*realloc)(void *ctx, void *ptr, size_t old_size, size_t size);
+	void (*free)(void *ctx, void *ptr, size_t size);
+	void *ctx;
+};
+
+/**
+ * Allocate, reallocate and free memory with ``a``, or the C library if it is
+ * ``NULL``; zz_calloc() returns zeroed memory.
+ */
+static inline void *zz_alloc(const struct zz_allocator *a, size_t size)
+{
+	if (a == NULL)
+		return malloc(size);
+	return a->alloc(a->ctx, size);
+}
+static inline void *zz_calloc(const struct zz_allocator *a, size_t size)
+{
+	void *ptr;
+
+	if (a == NULL)
+		return calloc(1, size);
+	ptr = a->alloc(a->ctx, size);
+	memset(ptr, 0, size);
+	return ptr;
+}
+static inline void *zz_realloc(const struct zz_allocator *a, void *ptr,
+		size_t old_size, size_t size)
+{
+	if (a == NULL)
+		return realloc(ptr, size);
+	return a->realloc(a->ctx, ptr, old_size, size);
+}
+static inline void zz_free(const struct zz_allocator *a, void *ptr, size_t size)
+{
+	if (a == NULL)
+		free(ptr);
+	else
+		a->free(a->ctx, ptr, size);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif          // ZEBU_ALLOC_H_
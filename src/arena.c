@@ -0,0 +1,80 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "arena.h"
+
+#include <assert.h>
+
+void zz_arena_init(struct zz_arena *arena, const struct zz_allocator *allocator)
+{
+	arena->chunks = NULL;
+	arena->allocator = allocator;
+	arena->bytes = 0;
+}
+
+void zz_arena_destroy(struct zz_arena *arena)
+{
+	struct zz_arena_chunk *chunk, *next;
+
+	for (chunk = arena->chunks; chunk != NULL; chunk = next) {
+		next = chunk->next;
+		zz_free(arena->allocator, chunk, chunk->size);
+	}
+	arena->chunks = NULL;
+	arena->bytes = 0;
+}
+
+void *zz_arena_alloc(struct zz_arena *arena, size_t size, size_t align)
+{
+	struct zz_arena_chunk *chunk = arena->chunks;
+	size_t offset, chunk_size;
+
+	assert(align > 0 && (align & (align - 1)) == 0);
+	if (chunk != NULL) {
+		offset = (chunk->used + align - 1) & ~(align - 1);
+		if (offset + size <= chunk->size) {
+			chunk->used = offset + size;
+			return (char *)chunk + offset;
+		}
+	}
+
+	offset = (sizeof(*chunk) + align - 1) & ~(align - 1);
+	chunk_size = offset + size;
+	if (chunk_size < ZZ_ARENA_CHUNK_SIZE)
+		chunk_size = ZZ_ARENA_CHUNK_SIZE;
+	chunk = zz_alloc(arena->allocator, chunk_size);
+	chunk->size = chunk_size;
+	chunk->used = offset + size;
+	arena->bytes += chunk->size;
+	/* Keep allocating from the emptier of the two chunks */
+	if (arena->chunks != NULL &&
+			chunk->size - chunk->used < arena->chunks->size -
+			arena->chunks->used) {
+		chunk->next = arena->chunks->next;
+		arena->chunks->next = chunk;
+	} else {
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+	}
+	return (char *)chunk + offset;
+}
+
+void zz_arena_merge(struct zz_arena *dst, struct zz_arena *src)
+{
+	struct zz_arena_chunk *last;
+
+	assert(dst->allocator == src->allocator);
+	if (src->chunks == NULL)
+		return;
+	for (last = src->chunks; last->next != NULL; last = last->next)
+		continue;
+	/* Chunks of src go after the current one of dst, that stays in use */
+	if (dst->chunks != NULL) {
+		last->next = dst->chunks->next;
+		dst->chunks->next = src->chunks;
+	} else {
+		dst->chunks = src->chunks;
+	}
+	dst->bytes += src->bytes;
+	src->chunks = NULL;
+	src->bytes = 0;
+}
@@ -0,0 +1,69 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_ARENA_H_
+#define ZEBU_ARENA_H_
+
+#include <stddef.h>
+
+#include "alloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Arena
+ * -----
+ *
+ * Bump allocator for memory that lives as long as its owner, typically a tree;
+ * blocks are carved out of chunks taken from an allocator, and are only freed
+ * all at once, when the arena is destroyed. Arenas are not thread-safe.
+ */
+
+/**
+ * Default size of the chunks, including their header; larger blocks get a
+ * chunk of their own
+ */
+#define ZZ_ARENA_CHUNK_SIZE 4096
+
+/**
+ * Chunk of memory in an arena
+ */
+struct zz_arena_chunk {
+	struct zz_arena_chunk *next;
+	size_t size;
+	size_t used;
+};
+
+/**
+ * List of chunks, the newest first, and the allocator they come from
+ */
+struct zz_arena {
+	struct zz_arena_chunk *chunks;
+	const struct zz_allocator *allocator;
+	size_t bytes;
+};
+
+/**
+ * Initialize an arena that takes its memory from ``allocator``
+ */
+void zz_arena_init(struct zz_arena *arena, const struct zz_allocator *allocator);
+/**
+ * Free all the memory in the arena
+ */
+void zz_arena_destroy(struct zz_arena *arena);
+/**
+ * Allocate ``size`` bytes aligned to ``align``, that must be a power of two
+ */
+void *zz_arena_alloc(struct zz_arena *arena, size_t size, size_t align);
+/**
+ * Move all the memory of ``src`` to ``dst``; both must use the same
+ * allocator, and ``src`` is left empty.
+ */
+void zz_arena_merge(struct zz_arena *dst, struct zz_arena *src);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif          // ZEBU_ARENA_H_
@@ -0,0 +1,428 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "bytecode.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Values that zz_program_run() keeps on the C stack */
+#define LOCAL_STACK 64
+
+/* Rows that zz_program_run_batch() evaluates at a time */
+#define CHUNK 256
+
+void zz_program_init(struct zz_program *program)
+{
+	program->tokens = NULL;
+	program->num_tokens = 0;
+	program->functions = NULL;
+	program->num_functions = 0;
+	program->code = NULL;
+	program->size = 0;
+	program->alloc = 0;
+	program->max_depth = 0;
+	program->max_arity = 0;
+	program->num_inputs = 0;
+}
+
+void zz_program_destroy(struct zz_program *program)
+{
+	free(program->tokens);
+	free(program->functions);
+	free(program->code);
+	zz_program_init(program);
+}
+
+static struct zz_program_token *lookup(const struct zz_program *program,
+		const char *token)
+{
+	unsigned int i;
+
+	for (i = 0; i < program->num_tokens; ++i)
+		if (program->tokens[i].token == token)
+			return &program->tokens[i];
+	return NULL;
+}
+
+static struct zz_program_token *add_token(struct zz_program *program,
+		const char *token)
+{
+	struct zz_program_token *t;
+
+	t = lookup(program, token);
+	if (t != NULL)
+		return t;
+	program->tokens = realloc(program->tokens,
+			(program->num_tokens + 1) * sizeof(*program->tokens));
+	t = &program->tokens[program->num_tokens++];
+	t->token = token;
+	return t;
+}
+
+void zz_program_opcode(struct zz_program *program, const char *token,
+		enum zz_opcode opcode)
+{
+	struct zz_program_token *t;
+
+	assert(opcode != ZZ_OP_CALL);
+	t = add_token(program, token);
+	t->opcode = opcode;
+	t->function = 0;
+}
+
+void zz_program_function(struct zz_program *program, const char *token,
+		double (*fn)(const double *args, unsigned int arity, void *data),
+		void *data)
+{
+	struct zz_program_token *t;
+	struct zz_program_function *f;
+
+	program->functions = realloc(program->functions,
+			(program->num_functions + 1) *
+			sizeof(*program->functions));
+	f = &program->functions[program->num_functions];
+	f->fn = fn;
+	f->data = data;
+	t = add_token(program, token);
+	t->opcode = ZZ_OP_CALL;
+	t->function = program->num_functions++;
+}
+
+static int constant(struct zz_node *node, double *value)
+{
+	switch (zz_data_type(node->data)) {
+	case ZZ_INT:
+		*value = zz_get_int(node);
+		return 0;
+	case ZZ_UINT:
+		*value = zz_get_uint(node);
+		return 0;
+	case ZZ_DOUBLE:
+		*value = zz_get_double(node);
+		return 0;
+#ifndef ZZ_COMPACT_DATA
+	case ZZ_INT64:
+		*value = zz_get_int64(node);
+		return 0;
+	case ZZ_UINT64:
+		*value = zz_get_uint64(node);
+		return 0;
+#endif
+	default:
+		return -1;
+	}
+}
+
+static int input(struct zz_node *node, unsigned int *index)
+{
+	switch (zz_data_type(node->data)) {
+	case ZZ_INT:
+		if (zz_get_int(node) < 0)
+			return -1;
+		*index = zz_get_int(node);
+		return 0;
+	case ZZ_UINT:
+		*index = zz_get_uint(node);
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+/* Append the instruction of node, whose children have been compiled, and
+ * keep track of how deep the stack gets */
+static int emit(struct zz_program *program, struct zz_node *node,
+		unsigned int arity, unsigned int *depth)
+{
+	const struct zz_program_token *t;
+	struct zz_instruction ins = { ZZ_OP_NONE, arity, 0, 0 };
+
+	t = lookup(program, node->token);
+	if (t == NULL)
+		return -1;
+	ins.opcode = t->opcode;
+	switch (t->opcode) {
+	case ZZ_OP_CONST:
+		if (arity != 0 || constant(node, &ins.value) < 0)
+			return -1;
+		break;
+	case ZZ_OP_INPUT:
+		if (arity != 0 || input(node, &ins.arg) < 0)
+			return -1;
+		if (ins.arg >= program->num_inputs)
+			program->num_inputs = ins.arg + 1;
+		break;
+	case ZZ_OP_ADD:
+	case ZZ_OP_SUB:
+	case ZZ_OP_MUL:
+	case ZZ_OP_DIV:
+		if (arity != 2)
+			return -1;
+		break;
+	case ZZ_OP_NEG:
+		if (arity != 1)
+			return -1;
+		break;
+	case ZZ_OP_CALL:
+		if (arity > USHRT_MAX)
+			return -1;
+		ins.arg = t->function;
+		if (arity > program->max_arity)
+			program->max_arity = arity;
+		break;
+	default:
+		return -1;
+	}
+	if (program->size == program->alloc) {
+		program->alloc = program->alloc ? program->alloc * 2 : 16;
+		program->code = realloc(program->code,
+				program->alloc * sizeof(*program->code));
+	}
+	program->code[program->size++] = ins;
+	*depth = *depth + 1 - arity;
+	if (*depth > program->max_depth)
+		program->max_depth = *depth;
+	return 0;
+}
+
+/* Node being compiled, its next child, and the children seen so far */
+struct frame {
+	struct zz_node *node;
+	struct zz_node *child;
+	unsigned int arity;
+};
+
+/* Emit the nodes of the subtree in post-order, with a heap stack of their
+ * ancestors */
+int zz_program_compile(struct zz_program *program, struct zz_node *root)
+{
+	struct frame *stack, *f;
+	struct zz_node *node;
+	size_t size = 0, alloc = 64;
+	unsigned int depth = 0;
+	int ret = 0;
+
+	program->size = 0;
+	program->max_depth = 0;
+	program->max_arity = 0;
+	program->num_inputs = 0;
+	stack = malloc(alloc * sizeof(*stack));
+	stack[size].node = root;
+	stack[size].child = zz_first_child(root);
+	stack[size++].arity = 0;
+	while (size > 0) {
+		f = &stack[size - 1];
+		if (f->child == NULL) {
+			ret = emit(program, f->node, f->arity, &depth);
+			if (ret < 0) {
+				program->size = 0;
+				break;
+			}
+			--size;
+			continue;
+		}
+		node = f->child;
+		f->child = zz_next_sibling(f->node, node);
+		++f->arity;
+		if (size == alloc) {
+			alloc *= 2;
+			stack = realloc(stack, alloc * sizeof(*stack));
+		}
+		stack[size].node = node;
+		stack[size].child = zz_first_child(node);
+		stack[size++].arity = 0;
+	}
+	free(stack);
+	return ret;
+}
+
+double zz_program_run(const struct zz_program *program, const double *inputs)
+{
+	double local[LOCAL_STACK], *stack = local, *sp, ret;
+	const struct zz_instruction *ins, *end;
+	const struct zz_program_function *f;
+
+	if (program->size == 0)
+		return NAN;
+	if (program->max_depth > LOCAL_STACK)
+		stack = malloc(program->max_depth * sizeof(*stack));
+	/* The result ends at the bottom of the stack, where the first
+	 * instruction pushes; set it anyway so that the compiler can tell it
+	 * is never read uninitialized */
+	stack[0] = NAN;
+	sp = stack;
+	end = program->code + program->size;
+	for (ins = program->code; ins != end; ++ins) {
+		switch (ins->opcode) {
+		case ZZ_OP_CONST:
+			*sp++ = ins->value;
+			break;
+		case ZZ_OP_INPUT:
+			*sp++ = inputs[ins->arg];
+			break;
+		case ZZ_OP_ADD:
+			--sp;
+			sp[-1] += sp[0];
+			break;
+		case ZZ_OP_SUB:
+			--sp;
+			sp[-1] -= sp[0];
+			break;
+		case ZZ_OP_MUL:
+			--sp;
+			sp[-1] *= sp[0];
+			break;
+		case ZZ_OP_DIV:
+			--sp;
+			sp[-1] /= sp[0];
+			break;
+		case ZZ_OP_NEG:
+			sp[-1] = -sp[-1];
+			break;
+		case ZZ_OP_CALL:
+			f = &program->functions[ins->arg];
+			sp -= ins->arity;
+			*sp = f->fn(sp, ins->arity, f->data);
+			++sp;
+			break;
+		}
+	}
+	ret = stack[0];
+	if (stack != local)
+		free(stack);
+	return ret;
+}
+
+/* Kernels of zz_program_run_batch(), on whole chunks */
+static void fill(double *restrict a, double value)
+{
+	size_t i;
+
+	for (i = 0; i < CHUNK; ++i)
+		a[i] = value;
+}
+
+static void add(double *restrict a, const double *restrict b)
+{
+	size_t i;
+
+	for (i = 0; i < CHUNK; ++i)
+		a[i] += b[i];
+}
+
+static void sub(double *restrict a, const double *restrict b)
+{
+	size_t i;
+
+	for (i = 0; i < CHUNK; ++i)
+		a[i] -= b[i];
+}
+
+static void mul(double *restrict a, const double *restrict b)
+{
+	size_t i;
+
+	for (i = 0; i < CHUNK; ++i)
+		a[i] *= b[i];
+}
+
+static void divide(double *restrict a, const double *restrict b)
+{
+	size_t i;
+
+	for (i = 0; i < CHUNK; ++i)
+		a[i] /= b[i];
+}
+
+static void neg(double *restrict a)
+{
+	size_t i;
+
+	for (i = 0; i < CHUNK; ++i)
+		a[i] = -a[i];
+}
+
+/* Call a function for each of the first n rows of a chunk, with the
+ * arguments gathered from the arity slots at sp */
+static void call(const struct zz_program_function *f, unsigned int arity,
+		double (*sp)[CHUNK], size_t n, double *args)
+{
+	size_t i;
+	unsigned int j;
+
+	for (i = 0; i < n; ++i) {
+		for (j = 0; j < arity; ++j)
+			args[j] = sp[j][i];
+		sp[0][i] = f->fn(args, arity, f->data);
+	}
+}
+
+/* The stack holds a chunk of values per slot; rows past the end of the input
+ * in the last chunk are zero, and their results are dropped */
+void zz_program_run_batch(const struct zz_program *program,
+		const double *const *columns, size_t rows, double *out)
+{
+	double (*stack)[CHUNK], (*sp)[CHUNK], *args;
+	const struct zz_instruction *ins, *end;
+	size_t base, n;
+
+	if (program->size == 0) {
+		for (base = 0; base < rows; ++base)
+			out[base] = NAN;
+		return;
+	}
+	if (rows == 0)
+		return;
+	stack = calloc(program->max_depth, sizeof(*stack));
+	args = malloc((program->max_arity + 1) * sizeof(*args));
+	end = program->code + program->size;
+	for (base = 0; base < rows; base += n) {
+		n = rows - base < CHUNK ? rows - base : CHUNK;
+		sp = stack;
+		for (ins = program->code; ins != end; ++ins) {
+			switch (ins->opcode) {
+			case ZZ_OP_CONST:
+				fill(*sp++, ins->value);
+				break;
+			case ZZ_OP_INPUT:
+				memcpy(*sp, columns[ins->arg] + base,
+						n * sizeof(**sp));
+				if (n < CHUNK)
+					memset(*sp + n, 0,
+						(CHUNK - n) * sizeof(**sp));
+				++sp;
+				break;
+			case ZZ_OP_ADD:
+				--sp;
+				add(sp[-1], sp[0]);
+				break;
+			case ZZ_OP_SUB:
+				--sp;
+				sub(sp[-1], sp[0]);
+				break;
+			case ZZ_OP_MUL:
+				--sp;
+				mul(sp[-1], sp[0]);
+				break;
+			case ZZ_OP_DIV:
+				--sp;
+				divide(sp[-1], sp[0]);
+				break;
+			case ZZ_OP_NEG:
+				neg(sp[-1]);
+				break;
+			case ZZ_OP_CALL:
+				sp -= ins->arity;
+				call(&program->functions[ins->arg], ins->arity,
+						sp, n, args);
+				++sp;
+				break;
+			}
+		}
+		memcpy(out + base, sp[-1], n * sizeof(*out));
+	}
+	free(args);
+	free(stack);
+}
@@ -0,0 +1,155 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_BYTECODE_H_
+#define ZEBU_BYTECODE_H_
+
+#include <stddef.h>
+
+#include "node.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Bytecode
+ * --------
+ *
+ * Expression trees compiled into a flat array of instructions in postfix
+ * order, that a loop over the array evaluates with a stack of doubles, for
+ * expressions that are evaluated many times. The program is told what every
+ * token does with zz_program_opcode() or zz_program_function(), and the nodes
+ * of the tree must use those tokens and no others. For example, for the
+ * calculator in the usage guide::
+ *
+ *     zz_program_opcode(&program, TOK_NUM, ZZ_OP_CONST);
+ *     zz_program_opcode(&program, TOK_ADD, ZZ_OP_ADD);
+ *     zz_program_function(&program, TOK_EXP, power, NULL);
+ *     zz_program_compile(&program, line);
+ *     result = zz_program_run(&program, NULL);
+ *
+ * Arithmetic is done on doubles: the int, uint, int64 and uint64 payloads of
+ * constants are converted when compiling, so the results are the same as
+ * converting the payloads to double and evaluating the tree by hand. The
+ * compiled program doesn't refer to the tree, which can be edited or
+ * destroyed afterwards.
+ *
+ * To evaluate an expression for many rows of inputs, zz_program_run_batch()
+ * takes the inputs as columns, and runs every instruction over a chunk of
+ * rows before moving on to the next, with loops over fixed-size arrays that
+ * the compiler turns into SIMD code. The operations are the same, and done in
+ * the same order, as in zz_program_run(), so the results are too, bit for
+ * bit; functions are still called once per row.
+ */
+
+/**
+ * What a token does
+ */
+enum zz_opcode {
+	ZZ_OP_NONE,
+	ZZ_OP_CONST,
+	ZZ_OP_INPUT,
+	ZZ_OP_ADD,
+	ZZ_OP_SUB,
+	ZZ_OP_MUL,
+	ZZ_OP_DIV,
+	ZZ_OP_NEG,
+	ZZ_OP_CALL
+};
+
+/**
+ * Instruction: a constant ``value``, the index ``arg`` of an input or of a
+ * function called with the ``arity`` values on top of the stack, or an
+ * arithmetic operation
+ */
+struct zz_instruction {
+	unsigned short opcode;
+	unsigned short arity;
+	unsigned int arg;
+	double value;
+};
+
+/**
+ * Function called by ``ZZ_OP_CALL``
+ */
+struct zz_program_function {
+	double (*fn)(const double *args, unsigned int arity, void *data);
+	void *data;
+};
+
+/**
+ * Opcode of a token, and the function it calls for ``ZZ_OP_CALL``
+ */
+struct zz_program_token {
+	const char *token;
+	enum zz_opcode opcode;
+	unsigned int function;
+};
+
+/**
+ * Tokens known to the program, and the code compiled last
+ */
+struct zz_program {
+	struct zz_program_token *tokens;
+	unsigned int num_tokens;
+	struct zz_program_function *functions;
+	unsigned int num_functions;
+	struct zz_instruction *code;
+	size_t size;
+	size_t alloc;
+	unsigned int max_depth;
+	unsigned int max_arity;
+	unsigned int num_inputs;
+};
+
+/**
+ * Initialize a program that knows no tokens and has no code
+ */
+void zz_program_init(struct zz_program *program);
+/**
+ * Free the program
+ */
+void zz_program_destroy(struct zz_program *program);
+/**
+ * Compile nodes with ``token`` to ``opcode``, replacing what the token did
+ * before. Nodes of ``ZZ_OP_CONST`` push their numeric payload, nodes of
+ * ``ZZ_OP_INPUT`` push the input whose index is their int or uint payload,
+ * and both must have no children; ``ZZ_OP_NEG`` takes one child, and the
+ * other arithmetic operations take two.
+ */
+void zz_program_opcode(struct zz_program *program, const char *token,
+		enum zz_opcode opcode);
+/**
+ * Compile nodes with ``token`` to a call to ``fn`` with the values of their
+ * children, in order, and ``data``
+ */
+void zz_program_function(struct zz_program *program, const char *token,
+		double (*fn)(const double *args, unsigned int arity, void *data),
+		void *data);
+/**
+ * Compile the subtree under ``root``, replacing the code of the program;
+ * returns 0, or -1 if a node has a token the program doesn't know, the wrong
+ * number of children, or a payload that doesn't fit its opcode, in which case
+ * the program is left without code.
+ */
+int zz_program_compile(struct zz_program *program, struct zz_node *root);
+/**
+ * Evaluate the code of the program with ``inputs``, that must hold at least
+ * ``num_inputs`` values; a program without code, as left by a failed
+ * compilation, evaluates to NaN.
+ */
+double zz_program_run(const struct zz_program *program, const double *inputs);
+/**
+ * Evaluate the code of the program for ``rows`` rows of inputs, storing the
+ * results in ``out``; input ``i`` of row ``r`` is ``columns[i][r]``, and
+ * there must be at least ``num_inputs`` columns. Every result is NaN if the
+ * program has no code.
+ */
+void zz_program_run_batch(const struct zz_program *program,
+		const double *const *columns, size_t rows, double *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif          // ZEBU_BYTECODE_H_
@@ -0,0 +1,55 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "column.h"
+
+#include <string.h>
+
+/* Minimum number of values allocated at once */
+#define COLUMN_MIN 64
+
+void zz_column_init(struct zz_column *column, size_t width,
+		const struct zz_allocator *allocator)
+{
+	column->width = width;
+	column->size = 0;
+	column->values = NULL;
+	column->allocator = allocator;
+}
+
+void zz_column_destroy(struct zz_column *column)
+{
+	if (column->values != NULL)
+		zz_free(column->allocator, column->values,
+				column->size * column->width);
+	column->size = 0;
+	column->values = NULL;
+}
+
+void zz_column_reserve(struct zz_column *column, size_t size)
+{
+	size_t alloc;
+
+	if (size <= column->size)
+		return;
+	alloc = column->size * 2;
+	if (alloc < size)
+		alloc = size;
+	if (alloc < COLUMN_MIN)
+		alloc = COLUMN_MIN;
+	if (column->values == NULL)
+		column->values = zz_alloc(column->allocator,
+				alloc * column->width);
+	else
+		column->values = zz_realloc(column->allocator, column->values,
+				column->size * column->width,
+				alloc * column->width);
+	memset(column->values + column->size * column->width, 0,
+			(alloc - column->size) * column->width);
+	column->size = alloc;
+}
+
+void zz_column_clear(struct zz_column *column)
+{
+	if (column->values != NULL)
+		memset(column->values, 0, column->size * column->width);
+}
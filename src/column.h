@@ -0,0 +1,94 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_COLUMN_H_
+#define ZEBU_COLUMN_H_
+
+#include <stddef.h>
+
+#include "alloc.h"
+#include "node.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Column
+ * ------
+ *
+ * Attributes of nodes stored apart from the nodes, in arrays indexed by node
+ * id, so that a pass can attach types, symbols or flags to the nodes of a tree
+ * without making every node bigger. A column holds values of one type, starts
+ * empty, grows as values are set, and is owned by whoever creates it: it can
+ * be destroyed before or after the tree. Values not set yet read as zero.
+ *
+ * Nodes of different trees may have the same id, so a column must only be used
+ * with the nodes of one tree. Recycled nodes keep their id, and with it the
+ * values of the node they replace.
+ */
+
+/**
+ * Values of ``width`` bytes for the first ``size`` node ids
+ */
+struct zz_column {
+	size_t width;
+	size_t size;
+	unsigned char *values;
+	const struct zz_allocator *allocator;
+};
+
+/**
+ * Initialize an empty column of values of ``width`` bytes, that takes its
+ * memory from ``allocator``
+ */
+void zz_column_init(struct zz_column *column, size_t width,
+		const struct zz_allocator *allocator);
+/**
+ * Free the values of the column
+ */
+void zz_column_destroy(struct zz_column *column);
+/**
+ * Make room for the values of the nodes with ids below ``size``, typically
+ * zz_tree_num_ids() of the tree, so that setting them never reallocates
+ */
+void zz_column_reserve(struct zz_column *column, size_t size);
+/**
+ * Set the values of all nodes to zero, keeping the memory
+ */
+void zz_column_clear(struct zz_column *column);
+
+/**
+ * Get a pointer to the value of ``node``, making room for it if needed; the
+ * pointer is valid until the column grows.
+ */
+static inline void *zz_column_at(struct zz_column *column,
+		const struct zz_node *node)
+{
+	if (node->id >= column->size)
+		zz_column_reserve(column, node->id + 1);
+	return column->values + (size_t)node->id * column->width;
+}
+/**
+ * Get a pointer to the value of ``node``, or ``NULL`` if no value of it or of
+ * any node with a higher id has been set
+ */
+static inline const void *zz_column_get(const struct zz_column *column,
+		const struct zz_node *node)
+{
+	if (node->id >= column->size)
+		return NULL;
+	return column->values + (size_t)node->id * column->width;
+}
+
+/**
+ * Access the value of ``node`` as an lvalue of ``type``, that must be
+ * ``width`` bytes long
+ */
+#define zz_column_ref(column, node, type) \
+(*(type *)zz_column_at(column, node))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif          // ZEBU_COLUMN_H_
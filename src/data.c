@@ -2,29 +2,236 @@
 
 #include "data.h"
 
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "dict.h"
+#include "trace.h"
 
 static struct zz_dict *strings = NULL;
+static pthread_mutex_t strings_lock = PTHREAD_MUTEX_INITIALIZER;
 
 const struct zz_data zz_null = { ZZ_NULL };
 
-struct zz_data zz_string(const char *str)
+#ifdef ZZ_COMPACT_DATA
+static struct zz_data string_data(const char *str)
+{
+	return zz_data_box(ZZ_STRING, (uintptr_t)str);
+}
+
+static struct zz_data short_string_data(const char *str, size_t len)
+{
+	struct zz_data data = { 0 };
+
+	memcpy(&data.bits, str, len + 1);
+	data.bits |= zz_data_box(ZZ_SHORT_STRING, 0).bits;
+	return data;
+}
+#else
+static struct zz_data string_data(const char *str)
 {
-	struct zz_data data = { ZZ_STRING };
-	strings = zz_dict_insert(strings, str, &data.data.string_val);
+	return (struct zz_data){ .type = ZZ_STRING, .data.string_val = str };
+}
+
+static struct zz_data short_string_data(const char *str, size_t len)
+{
+	struct zz_data data = { ZZ_SHORT_STRING };
+
+	memcpy(data.data.short_val, str, len + 1);
 	return data;
 }
+#endif
+
+struct zz_data zz_string(const char *str)
+{
+	const char *interned;
+	int inserted;
+
+	pthread_mutex_lock(&strings_lock);
+	strings = zz_dict_insert_ex(strings, str, &interned, &inserted);
+	pthread_mutex_unlock(&strings_lock);
+	if (ZZ_TRACING()) {
+		if (inserted)
+			ZZ_TRACE(ZZ_EVENT_STRING_MISS, string_miss, interned,
+					strlen(str));
+		else
+			ZZ_TRACE(ZZ_EVENT_STRING_HIT, string_hit, interned,
+					strlen(str));
+	}
+	return string_data(interned);
+}
+
+struct zz_data zz_short_string(const char *str)
+{
+	size_t len;
+
+	len = strnlen(str, ZZ_SHORT_STRING_MAX + 1);
+	if (len <= ZZ_SHORT_STRING_MAX)
+		return short_string_data(str, len);
+	return zz_string(str);
+}
+
+struct zz_data zz_data_intern(struct zz_data x)
+{
+#ifndef ZZ_COMPACT_DATA
+	char buf[64], *str;
+	const char *slice;
+	size_t length;
+
+	if (zz_data_type(x) != ZZ_SLICE)
+		return x;
+	slice = zz_to_slice(x, &length);
+	str = length < sizeof(buf) ? buf : malloc(length + 1);
+	memcpy(str, slice, length);
+	str[length] = '\0';
+	x = zz_string(str);
+	if (str != buf)
+		free(str);
+#endif
+	return x;
+}
+
+static void trace_delete(const char *str)
+{
+	if (ZZ_TRACING())
+		ZZ_TRACE(ZZ_EVENT_STRING_DEL, string_delete, str, strlen(str));
+}
 
 void zz_data_destroy(struct zz_data x)
 {
-	if (x.type == ZZ_STRING)
-		strings = zz_dict_delete(strings, x.data.string_val);
+	if (zz_data_type(x) == ZZ_STRING) {
+		trace_delete(zz_to_string(x));
+		pthread_mutex_lock(&strings_lock);
+		strings = zz_dict_delete(strings, zz_to_string(x));
+		pthread_mutex_unlock(&strings_lock);
+	}
 }
 
 struct zz_data zz_data_copy(struct zz_data x)
 {
-	struct zz_data y = x;
-	if (x.type == ZZ_STRING)
-		strings = zz_dict_insert(strings, x.data.string_val, &y.data.string_val);
-	return y;
+	if (zz_data_type(x) == ZZ_STRING) {
+		pthread_mutex_lock(&strings_lock);
+		strings = zz_dict_insert(strings, zz_to_string(x), NULL);
+		pthread_mutex_unlock(&strings_lock);
+	}
+	return x;
+}
+
+/* Get the characters of a string or slice, or NULL for other data */
+static const char *string_chars(const struct zz_data *x, size_t *length)
+{
+	const char *str;
+
+	switch (zz_data_type(*x)) {
+	case ZZ_STRING:
+	case ZZ_SHORT_STRING:
+		str = zz_data_string(x);
+		*length = strlen(str);
+		return str;
+#ifndef ZZ_COMPACT_DATA
+	case ZZ_SLICE:
+		return zz_to_slice(*x, length);
+#endif
+	default:
+		return NULL;
+	}
+}
+
+/* Get the value of an integer, or return 0 for other data */
+static int integer_value(struct zz_data x, int64_t *value, int *is_unsigned)
+{
+	*is_unsigned = 0;
+	switch (zz_data_type(x)) {
+	case ZZ_INT:
+		*value = zz_to_int(x);
+		return 1;
+	case ZZ_UINT:
+		*value = zz_to_uint(x);
+		return 1;
+#ifndef ZZ_COMPACT_DATA
+	case ZZ_INT64:
+		*value = zz_to_int64(x);
+		return 1;
+	case ZZ_UINT64:
+		*value = (int64_t)zz_to_uint64(x);
+		*is_unsigned = *value < 0;
+		return 1;
+#endif
+	default:
+		return 0;
+	}
+}
+
+int zz_data_equal(struct zz_data a, struct zz_data b)
+{
+	const char *sa, *sb;
+	size_t la, lb;
+	int64_t ia, ib;
+	int ua, ub;
+
+	if ((sa = string_chars(&a, &la)) != NULL) {
+		sb = string_chars(&b, &lb);
+		return sb != NULL && la == lb && memcmp(sa, sb, la) == 0;
+	}
+	if (integer_value(a, &ia, &ua))
+		return integer_value(b, &ib, &ub) && ia == ib && ua == ub;
+	if (zz_data_type(a) != zz_data_type(b))
+		return 0;
+	switch (zz_data_type(a)) {
+	case ZZ_NULL:
+		return 1;
+	case ZZ_DOUBLE:
+		return zz_to_double(a) == zz_to_double(b);
+	case ZZ_POINTER:
+		return zz_to_pointer(a) == zz_to_pointer(b);
+#ifndef ZZ_COMPACT_DATA
+	case ZZ_BLOB:
+		sa = (const char *)zz_to_blob(a, &la);
+		sb = (const char *)zz_to_blob(b, &lb);
+		return la == lb && memcmp(sa, sb, la) == 0;
+#endif
+	default:
+		return 0;
+	}
+}
+
+void zz_data_ref_batch(const struct zz_data *x, size_t count)
+{
+	size_t i;
+
+	pthread_mutex_lock(&strings_lock);
+	for (i = 0; i < count; ++i)
+		if (zz_data_type(x[i]) == ZZ_STRING)
+			strings = zz_dict_insert(strings, zz_to_string(x[i]), NULL);
+	pthread_mutex_unlock(&strings_lock);
+}
+
+void zz_data_destroy_batch(const struct zz_data *x, size_t count)
+{
+	size_t i;
+
+	for (i = 0; i < count; ++i)
+		if (zz_data_type(x[i]) == ZZ_STRING)
+			trace_delete(zz_to_string(x[i]));
+	pthread_mutex_lock(&strings_lock);
+	for (i = 0; i < count; ++i)
+		if (zz_data_type(x[i]) == ZZ_STRING)
+			strings = zz_dict_delete(strings, zz_to_string(x[i]));
+	pthread_mutex_unlock(&strings_lock);
+}
+
+void zz_string_set_allocator(const struct zz_allocator *allocator)
+{
+	pthread_mutex_lock(&strings_lock);
+	assert(strings == NULL);
+	zz_dict_set_allocator(allocator);
+	pthread_mutex_unlock(&strings_lock);
+}
+
+void zz_string_stats(struct zz_dict_stats *stats)
+{
+	pthread_mutex_lock(&strings_lock);
+	zz_dict_stats(strings, stats);
+	pthread_mutex_unlock(&strings_lock);
 }
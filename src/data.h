@@ -4,11 +4,16 @@
 #define ZEBU_DATA_H_
 
 #include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+struct zz_allocator;
+struct zz_dict_stats;
+
 /**
  * Data
  * ----
@@ -29,8 +34,41 @@ extern "C" {
  *    +--------------------+
  *    | ``ZZ_STRING``      |
  *    +--------------------+
+ *    | ``ZZ_SHORT_STRING``|
+ *    +--------------------+
  *    | ``ZZ_POINTER``     |
  *    +--------------------+
+ *    | ``ZZ_SLICE``       |
+ *    +--------------------+
+ *    | ``ZZ_INT64``       |
+ *    +--------------------+
+ *    | ``ZZ_UINT64``      |
+ *    +--------------------+
+ *    | ``ZZ_BLOB``        |
+ *    +--------------------+
+ *
+ * Strings made with zz_short_string() are stored inside the data itself as
+ * ``ZZ_SHORT_STRING`` when they are up to ``ZZ_SHORT_STRING_MAX`` bytes long,
+ * without going through the string dictionary; since they live in the data,
+ * they must be read through a pointer to it, with zz_data_string() or
+ * zz_get_string(), and not with zz_to_string(). zz_string() always interns.
+ *
+ * A ``ZZ_SLICE`` points to ``length`` bytes of a buffer owned by the caller,
+ * typically the source being parsed, which must outlive the data and any copy
+ * of it; it is neither copied nor interned, nor null-terminated. Use
+ * zz_data_intern() to turn it into a string when the buffer goes away.
+ *
+ * A ``ZZ_BLOB`` holds ``length`` bytes copied into the arena of a tree with
+ * zz_blob(), and lives until the node that holds it is recycled; it is meant
+ * for literals too wide for 64 bits, stored as the bytes of their magnitude in
+ * little-endian order, which is how zz_print() shows them.
+ *
+ * When the library and its users are built with ``ZZ_COMPACT_DATA`` defined
+ * (``make COMPACT_DATA=1``), data is NaN-boxed into 8 bytes instead of 16:
+ * doubles are stored as such, and every other type lives in the payload of a
+ * NaN, which limits pointers to 48 bits and short strings to 5 bytes. All NaNs
+ * read back as the same quiet NaN, and the type must be queried with
+ * zz_data_type() instead of looking at the struct.
  */
 
 /**
@@ -42,49 +80,159 @@ enum zz_data_type {
 	ZZ_UINT,
 	ZZ_DOUBLE,
 	ZZ_STRING,
-	ZZ_POINTER
+	ZZ_SHORT_STRING,
+	ZZ_POINTER,
+	ZZ_SLICE,
+	ZZ_INT64,
+	ZZ_UINT64,
+	ZZ_BLOB
 };
 
+#ifdef ZZ_COMPACT_DATA
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "ZZ_COMPACT_DATA requires a little-endian target"
+#endif
+
 /**
- * A field to indicate type and another to hold the data
+ * A double, or the type and payload of anything else in the low 51 bits of a
+ * negative quiet NaN; doubles are stored offset by ``ZZ_DATA_DOUBLE_OFFSET``,
+ * which moves those NaNs down to the top 16 bits ``0x0000`` to ``0x0007``, so
+ * that the type is the top 16 bits themselves and all zeroes is null
+ */
+struct zz_data {
+	uint64_t bits;
+};
+
+#define ZZ_DATA_PAYLOAD ((UINT64_C(1) << 48) - 1)
+#define ZZ_DATA_DOUBLE_OFFSET (UINT64_C(8) << 48)
+#define ZZ_DATA_NAN UINT64_C(0x7ff8000000000000)
+
+/**
+ * Longest string stored inline, not counting the terminating null
+ */
+#define ZZ_SHORT_STRING_MAX 5
+
+#else
+
+/**
+ * A field to indicate type and another to hold the data, plus the length of
+ * slices, that would otherwise be padding
  *
  */
 struct zz_data {
 	enum zz_data_type type;
+	unsigned int length;
 	union {
 		int int_val;
 		unsigned int uint_val;
 		double double_val;
 		const char *string_val;
 		void *pointer_val;
+		char short_val[8];
+		const char *slice_val;
+		int64_t int64_val;
+		uint64_t uint64_val;
+		const unsigned char *blob_val;
 	} data;
 };
 
+/**
+ * Longest string stored inline, not counting the terminating null
+ */
+#define ZZ_SHORT_STRING_MAX 7
+
+#endif
+
 /**
  * Null data
  *
  */
 extern const struct zz_data zz_null;
+/**
+ * Get the type of data
+ */
+#ifdef ZZ_COMPACT_DATA
+static inline enum zz_data_type zz_data_type(struct zz_data x)
+{
+	uint64_t tag = x.bits >> 48;
+	return tag < 8 ? (enum zz_data_type)tag : ZZ_DOUBLE;
+}
+static inline struct zz_data zz_data_box(enum zz_data_type type, uint64_t payload)
+{
+	return (struct zz_data){ (uint64_t)type << 48 | payload };
+}
+#else
+static inline enum zz_data_type zz_data_type(struct zz_data x)
+{
+	return x.type;
+}
+#endif
 /**
  * Create data from a given value
  */
+#ifdef ZZ_COMPACT_DATA
 static inline struct zz_data zz_int(int data)
 {
-	return (struct zz_data){ ZZ_INT, { .int_val = data }};
+	return zz_data_box(ZZ_INT, (unsigned int)data);
 }
 static inline struct zz_data zz_uint(unsigned int data)
 {
-	return (struct zz_data){ ZZ_UINT, { .uint_val = data }};
+	return zz_data_box(ZZ_UINT, data);
 }
 static inline struct zz_data zz_double(double data)
 {
-	return (struct zz_data){ ZZ_DOUBLE, { .double_val = data }};
+	union { double d; uint64_t u; } x = { data };
+	if (data != data)
+		x.u = ZZ_DATA_NAN;
+	return (struct zz_data){ x.u + ZZ_DATA_DOUBLE_OFFSET };
 }
+#else
+static inline struct zz_data zz_int(int data)
+{
+	return (struct zz_data){ .type = ZZ_INT, .data.int_val = data };
+}
+static inline struct zz_data zz_uint(unsigned int data)
+{
+	return (struct zz_data){ .type = ZZ_UINT, .data.uint_val = data };
+}
+static inline struct zz_data zz_double(double data)
+{
+	return (struct zz_data){ .type = ZZ_DOUBLE, .data.double_val = data };
+}
+static inline struct zz_data zz_int64(int64_t data)
+{
+	return (struct zz_data){ .type = ZZ_INT64, .data.int64_val = data };
+}
+static inline struct zz_data zz_uint64(uint64_t data)
+{
+	return (struct zz_data){ .type = ZZ_UINT64, .data.uint64_val = data };
+}
+#endif
 struct zz_data zz_string(const char *data);
+/**
+ * Create a string stored inline if it is at most ``ZZ_SHORT_STRING_MAX``
+ * bytes long, or interned as with zz_string() otherwise
+ */
+struct zz_data zz_short_string(const char *data);
+#ifdef ZZ_COMPACT_DATA
+static inline struct zz_data zz_pointer(void *data)
+{
+	assert(((uint64_t)(uintptr_t)data & ~ZZ_DATA_PAYLOAD) == 0);
+	return zz_data_box(ZZ_POINTER, (uintptr_t)data);
+}
+#else
 static inline struct zz_data zz_pointer(void *data)
 {
-	return (struct zz_data){ ZZ_POINTER, { .pointer_val = data }};
+	return (struct zz_data){ .type = ZZ_POINTER, .data.pointer_val = data };
+}
+static inline struct zz_data zz_slice(const char *data, size_t length)
+{
+	assert(length <= (unsigned int)-1);
+	return (struct zz_data){ .type = ZZ_SLICE, .length = length,
+		.data.slice_val = data };
 }
+#endif
 /**
  * Destroy data
  */
@@ -93,9 +241,74 @@ void zz_data_destroy(struct zz_data x);
  * Copy data
  */
 struct zz_data zz_data_copy(struct zz_data x);
+/**
+ * Intern a slice as a string, so that it no longer depends on its buffer;
+ * other data is returned unchanged
+ */
+struct zz_data zz_data_intern(struct zz_data x);
+/**
+ * Check whether two data have the same value: strings, short strings and
+ * slices compare by their characters, and integers of any width by their
+ * value
+ */
+int zz_data_equal(struct zz_data a, struct zz_data b);
+/**
+ * Take an additional reference to, or destroy, ``count`` data at once; same
+ * as calling zz_data_copy() or zz_data_destroy() on each of them, but locks
+ * the string dictionary only once.
+ */
+void zz_data_ref_batch(const struct zz_data *x, size_t count);
+void zz_data_destroy_batch(const struct zz_data *x, size_t count);
+/**
+ * Take memory for strings allocated with zz_string() from ``allocator``; must
+ * be called before creating any string, and the allocator must be thread-safe
+ * if strings are created from several threads.
+ */
+void zz_string_set_allocator(const struct zz_allocator *allocator);
+/**
+ * Get statistics of the dictionary that holds all strings allocated with
+ * zz_string(); the average reference count is ``references / strings``.
+ */
+void zz_string_stats(struct zz_dict_stats *stats);
 /**
  * Cast data to type
  */
+#ifdef ZZ_COMPACT_DATA
+static inline int zz_to_int(struct zz_data x)
+{
+	assert(zz_data_type(x) == ZZ_INT);
+	return (int)(unsigned int)x.bits;
+}
+static inline unsigned int zz_to_uint(struct zz_data x)
+{
+	assert(zz_data_type(x) == ZZ_UINT);
+	return (unsigned int)x.bits;
+}
+static inline double zz_to_double(struct zz_data x)
+{
+	union { uint64_t u; double d; } y = { x.bits - ZZ_DATA_DOUBLE_OFFSET };
+	assert(zz_data_type(x) == ZZ_DOUBLE);
+	return y.d;
+}
+static inline const char *zz_to_string(struct zz_data x)
+{
+	assert(zz_data_type(x) == ZZ_STRING);
+	return (const char *)(uintptr_t)(x.bits & ZZ_DATA_PAYLOAD);
+}
+static inline const char *zz_data_string(const struct zz_data *x)
+{
+	assert(zz_data_type(*x) == ZZ_STRING ||
+			zz_data_type(*x) == ZZ_SHORT_STRING);
+	if (zz_data_type(*x) == ZZ_SHORT_STRING)
+		return (const char *)x;
+	return (const char *)(uintptr_t)(x->bits & ZZ_DATA_PAYLOAD);
+}
+static inline void *zz_to_pointer(struct zz_data x)
+{
+	assert(zz_data_type(x) == ZZ_POINTER);
+	return (void *)(uintptr_t)(x.bits & ZZ_DATA_PAYLOAD);
+}
+#else
 static inline int zz_to_int(struct zz_data x)
 {
 	assert(x.type == ZZ_INT);
@@ -116,11 +329,41 @@ static inline const char *zz_to_string(struct zz_data x)
 	assert(x.type == ZZ_STRING);
 	return x.data.string_val;
 }
+static inline const char *zz_data_string(const struct zz_data *x)
+{
+	assert(x->type == ZZ_STRING || x->type == ZZ_SHORT_STRING);
+	if (x->type == ZZ_SHORT_STRING)
+		return x->data.short_val;
+	return x->data.string_val;
+}
 static inline void *zz_to_pointer(struct zz_data x)
 {
 	assert(x.type == ZZ_POINTER);
 	return x.data.pointer_val;
 }
+static inline const char *zz_to_slice(struct zz_data x, size_t *length)
+{
+	assert(x.type == ZZ_SLICE);
+	*length = x.length;
+	return x.data.slice_val;
+}
+static inline int64_t zz_to_int64(struct zz_data x)
+{
+	assert(x.type == ZZ_INT64);
+	return x.data.int64_val;
+}
+static inline uint64_t zz_to_uint64(struct zz_data x)
+{
+	assert(x.type == ZZ_UINT64);
+	return x.data.uint64_val;
+}
+static inline const unsigned char *zz_to_blob(struct zz_data x, size_t *length)
+{
+	assert(x.type == ZZ_BLOB);
+	*length = x.length;
+	return x.data.blob_val;
+}
+#endif
 
 #ifdef __cplusplus
 }
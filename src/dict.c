@@ -5,6 +5,8 @@
 #include <string.h>
 #include <unistd.h>
 
+static const struct zz_allocator *allocator = NULL;
+
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
 #define SWAP(a, b)\
@@ -14,6 +16,12 @@ do {\
 	b = tmp;\
 } while (0)
 
+static void free_node(struct zz_dict *t)
+{
+	zz_free(allocator, t->data, strlen(t->data) + 1);
+	zz_free(allocator, t, sizeof(*t));
+}
+
 static struct zz_dict *skew(struct zz_dict *t)
 {
 	struct zz_dict *l;
@@ -97,35 +105,48 @@ int zz_dict_lookup(struct zz_dict *t, const char *data, const char **rval)
 	return 0;
 }
 
-struct zz_dict *zz_dict_insert(struct zz_dict *t, const char *data,
-		const char **rval)
+struct zz_dict *zz_dict_insert_ex(struct zz_dict *t, const char *data,
+		const char **rval, int *inserted)
 {
 	int cmp;
+	size_t size;
 
 	if (t == NULL) {
-		t = calloc(1, sizeof(*t));
+		size = strlen(data) + 1;
+		t = zz_calloc(allocator, sizeof(*t));
 		t->level = 1;
 		t->ref_count = 1;
-		t->data = strdup(data);
+		t->data = zz_alloc(allocator, size);
+		memcpy(t->data, data, size);
 		if (rval != NULL)
 			*rval = t->data;
+		if (inserted != NULL)
+			*inserted = 1;
 		return t;
 	}
 	cmp = strcmp(data, t->data);
 	if (cmp < 0) {
-		t->left = zz_dict_insert(t->left, data, rval);
+		t->left = zz_dict_insert_ex(t->left, data, rval, inserted);
 	} else if (cmp > 0) {
-		t->right = zz_dict_insert(t->right, data, rval);
+		t->right = zz_dict_insert_ex(t->right, data, rval, inserted);
 	} else {
 		++t->ref_count;
 		if (rval != NULL)
 			*rval = t->data;
+		if (inserted != NULL)
+			*inserted = 0;
 	}
 	t = skew(t);
 	t = split(t);
 	return t;
 }
 
+struct zz_dict *zz_dict_insert(struct zz_dict *t, const char *data,
+		const char **rval)
+{
+	return zz_dict_insert_ex(t, data, rval, NULL);
+}
+
 struct zz_dict *zz_dict_delete(struct zz_dict *t, const char *data)
 {
 	int cmp;
@@ -144,8 +165,7 @@ struct zz_dict *zz_dict_delete(struct zz_dict *t, const char *data)
 		}
 		if (t->left == NULL) {
 			if (t->right == NULL) {
-				free(t->data);
-				free(t);
+				free_node(t);
 				return NULL;
 			}
 			struct zz_dict *l = sucessor(t);
@@ -177,8 +197,33 @@ void zz_dict_destroy(struct zz_dict *t)
 	if (t != NULL) {
 		zz_dict_destroy(t->left);
 		zz_dict_destroy(t->right);
-		free(t->data);
-		free(t);
+		free_node(t);
 	}
 }
 
+void zz_dict_set_allocator(const struct zz_allocator *a)
+{
+	allocator = a;
+}
+
+static void stats(struct zz_dict *t, struct zz_dict_stats *s, size_t depth)
+{
+	if (t == NULL)
+		return;
+	++s->strings;
+	s->references += t->ref_count;
+	s->bytes += sizeof(*t) + strlen(t->data) + 1;
+	if (depth > s->depth)
+		s->depth = depth;
+	stats(t->left, s, depth + 1);
+	stats(t->right, s, depth + 1);
+}
+
+void zz_dict_stats(struct zz_dict *t, struct zz_dict_stats *s)
+{
+	s->strings = 0;
+	s->references = 0;
+	s->bytes = 0;
+	s->depth = 0;
+	stats(t, s, 1);
+}
@@ -5,6 +5,8 @@
 
 #include <stdlib.h>
 
+#include "alloc.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -44,6 +46,12 @@ int zz_dict_lookup(struct zz_dict *t, const char *data, const char **rval);
  * through ``rval``.
  */
 struct zz_dict *zz_dict_insert(struct zz_dict *t, const char *data, const char **rval);
+/**
+ * Same as zz_dict_insert(), but unless ``inserted`` is ``NULL``, it is set to 1
+ * if a node was created and to 0 otherwise
+ */
+struct zz_dict *zz_dict_insert_ex(struct zz_dict *t, const char *data,
+		const char **rval, int *inserted);
 /**
  * Delete string from tree. If ``data`` exists in the tree, its reference
  * counter will be decremented by one; if it reaches zero, the node holding it
@@ -55,6 +63,30 @@ struct zz_dict *zz_dict_delete(struct zz_dict *t, const char *data);
  */
 void zz_dict_destroy(struct zz_dict *t);
 
+/**
+ * Take memory for the nodes and strings of all dictionaries from
+ * ``allocator``; ``NULL`` restores the C library. Must only be changed while
+ * there are no dictionaries.
+ */
+void zz_dict_set_allocator(const struct zz_allocator *allocator);
+
+/**
+ * Contents of a dictionary
+ */
+struct zz_dict_stats {
+	size_t strings;
+	size_t references;
+	size_t bytes;
+	size_t depth;
+};
+
+/**
+ * Get number of strings in the tree, the sum of their reference counts, the
+ * bytes used by strings and nodes, and the depth of the tree; walks the whole
+ * tree.
+ */
+void zz_dict_stats(struct zz_dict *t, struct zz_dict_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,247 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "literal.h"
+
+#include <float.h>
+#include <limits.h>
+#include <locale.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const double powers_of_ten[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+	1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static locale_t c_locale;
+static pthread_once_t c_locale_once = PTHREAD_ONCE_INIT;
+
+static void init_c_locale(void)
+{
+	c_locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+}
+
+static inline int is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+/* Check that the 8 bytes at str are decimal digits, and convert them with a
+ * few multiplications instead of one per digit */
+static inline int parse_eight_digits(const char *str, uint32_t *value)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	uint64_t v;
+
+	memcpy(&v, str, sizeof(v));
+	if (((v & UINT64_C(0xf0f0f0f0f0f0f0f0)) |
+			(((v + UINT64_C(0x0606060606060606)) &
+			  UINT64_C(0xf0f0f0f0f0f0f0f0)) >> 4)) !=
+			UINT64_C(0x3333333333333333))
+		return 0;
+	v -= UINT64_C(0x3030303030303030);
+	v = v * 10 + (v >> 8);
+	v = ((v & UINT64_C(0x000000ff000000ff)) * UINT64_C(0x000f424000000064) +
+			((v >> 16) & UINT64_C(0x000000ff000000ff)) *
+			UINT64_C(0x0000271000000001)) >> 32;
+	*value = v;
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+static inline unsigned int digit_value(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return 16;
+}
+
+static int make_int(uint64_t value, int negative, struct zz_data *data)
+{
+	if (negative) {
+		if (value <= (uint64_t)INT_MAX + 1) {
+			*data = zz_int(-(int64_t)value);
+			return 0;
+		}
+#ifndef ZZ_COMPACT_DATA
+		if (value <= (uint64_t)INT64_MAX + 1) {
+			*data = zz_int64(value == (uint64_t)INT64_MAX + 1 ?
+					INT64_MIN : -(int64_t)value);
+			return 0;
+		}
+#endif
+		return -1;
+	}
+	if (value <= INT_MAX)
+		*data = zz_int(value);
+	else if (value <= UINT_MAX)
+		*data = zz_uint(value);
+#ifndef ZZ_COMPACT_DATA
+	else if (value <= INT64_MAX)
+		*data = zz_int64(value);
+	else
+		*data = zz_uint64(value);
+#else
+	else
+		return -1;
+#endif
+	return 0;
+}
+
+int zz_parse_int(const char *str, size_t length, struct zz_data *data)
+{
+	const char *end = str + length;
+	uint64_t value = 0;
+	unsigned int base = 10, digit;
+	uint32_t eight;
+	int negative = 0;
+
+	if (str < end && (*str == '-' || *str == '+'))
+		negative = *str++ == '-';
+	if (end - str > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+		base = 16;
+		str += 2;
+	} else if (end - str > 2 && str[0] == '0' &&
+			(str[1] == 'b' || str[1] == 'B')) {
+		base = 2;
+		str += 2;
+	} else if (end - str > 1 && str[0] == '0') {
+		base = 8;
+		++str;
+	}
+	if (str == end)
+		return -1;
+
+	/* Up to 16 digits can't overflow, so take them 8 at a time */
+	if (base == 10)
+		while (end - str >= 8 && value < UINT64_C(100000000) &&
+				parse_eight_digits(str, &eight)) {
+			value = value * 100000000 + eight;
+			str += 8;
+		}
+	for (; str < end; ++str) {
+		digit = digit_value(*str);
+		if (digit >= base)
+			return -1;
+		if (value > (UINT64_MAX - digit) / base)
+			return -1;
+		value = value * base + digit;
+	}
+	return make_int(value, negative, data);
+}
+
+/* Parse the digits of a decimal significand, keeping at most 19 that are
+ * significant in ``mantissa`` and counting the rest in ``dropped``; chunks of
+ * 8 digits count as significant even if they start with zeros, which may drop
+ * digits early, but only ever sends numbers to the slow path */
+static const char *parse_digits(const char *str, const char *end,
+		uint64_t *mantissa, int *digits, int *dropped)
+{
+	uint32_t eight;
+
+	while (end - str >= 8 && *digits + 8 <= 19 &&
+			parse_eight_digits(str, &eight)) {
+		*mantissa = *mantissa * 100000000 + eight;
+		if (*digits > 0 || *mantissa > 0)
+			*digits += 8;
+		str += 8;
+	}
+	for (; str < end && is_digit(*str); ++str) {
+		if (*digits < 19) {
+			*mantissa = *mantissa * 10 + (*str - '0');
+			if (*digits > 0 || *mantissa > 0)
+				++*digits;
+		} else {
+			++*dropped;
+		}
+	}
+	return str;
+}
+
+/* Anything off the fast path goes through strtod() in the C locale, which is
+ * correctly rounded in glibc, and also takes care of hexadecimal floats,
+ * infinities and NaNs */
+static int parse_double_slow(const char *str, size_t length, double *value)
+{
+	char buf[64], *copy, *endp;
+	locale_t old;
+	int ok;
+
+	if (length == 0 || strchr(" \t\n\v\f\r", str[0]) != NULL)
+		return -1;
+	copy = length < sizeof(buf) ? buf : malloc(length + 1);
+	memcpy(copy, str, length);
+	copy[length] = '\0';
+	pthread_once(&c_locale_once, init_c_locale);
+	old = uselocale(c_locale);
+	*value = strtod(copy, &endp);
+	uselocale(old);
+	ok = endp == copy + length;
+	if (copy != buf)
+		free(copy);
+	return ok ? 0 : -1;
+}
+
+int zz_parse_double(const char *str, size_t length, struct zz_data *data)
+{
+	const char *p = str, *end = str + length, *digits_start, *fraction;
+	uint64_t mantissa = 0;
+	int digits = 0, dropped = 0, int_dropped, exponent, exp_value = 0;
+	int negative = 0, exp_negative = 0;
+	double value;
+
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = *p++ == '-';
+	digits_start = p;
+	p = parse_digits(p, end, &mantissa, &digits, &dropped);
+	exponent = dropped;
+	if (p < end && *p == '.') {
+		fraction = ++p;
+		int_dropped = dropped;
+		p = parse_digits(p, end, &mantissa, &digits, &dropped);
+		exponent -= (p - fraction) - (dropped - int_dropped);
+	}
+	if (p == digits_start || (p == digits_start + 1 && *digits_start == '.'))
+		goto slow;
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		++p;
+		if (p < end && (*p == '-' || *p == '+'))
+			exp_negative = *p++ == '-';
+		if (p == end || !is_digit(*p))
+			goto slow;
+		for (; p < end && is_digit(*p); ++p)
+			if (exp_value < 100000)
+				exp_value = exp_value * 10 + (*p - '0');
+		exponent += exp_negative ? -exp_value : exp_value;
+	}
+	if (p != end)
+		goto slow;
+
+	/* Clinger's fast path: both the significand and the power of ten are
+	 * exact doubles, so a single rounding gives the correct result */
+	if (FLT_EVAL_METHOD != 0 || dropped > 0 ||
+			mantissa > (UINT64_C(1) << 53) ||
+			exponent < -22 || exponent > 22)
+		goto slow;
+	value = mantissa;
+	if (exponent < 0)
+		value /= powers_of_ten[-exponent];
+	else
+		value *= powers_of_ten[exponent];
+	*data = zz_double(negative ? -value : value);
+	return 0;
+
+slow:
+	if (parse_double_slow(str, length, &value) < 0)
+		return -1;
+	*data = zz_double(value);
+	return 0;
+}
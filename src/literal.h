@@ -0,0 +1,44 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_LITERAL_H_
+#define ZEBU_LITERAL_H_
+
+#include <stddef.h>
+
+#include "data.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Literals
+ * --------
+ *
+ * Conversion of the text of numeric literals, as matched by a lexer, straight
+ * into data. The text is given as a pointer and a length, so it doesn't need
+ * to be null-terminated, and must be a literal in its entirety, without
+ * surrounding spaces. Parsing does not depend on the locale.
+ */
+
+/**
+ * Parse an integer literal, with an optional sign: hexadecimal with a ``0x``
+ * prefix, binary with ``0b``, octal with a leading ``0``, or decimal. The
+ * result is the first of ``ZZ_INT``, ``ZZ_UINT``, ``ZZ_INT64`` and
+ * ``ZZ_UINT64`` that can hold the value, the 64-bit types being unavailable
+ * with ``ZZ_COMPACT_DATA``. Returns 0 on success, or -1 if the text is not a
+ * valid literal or the value doesn't fit.
+ */
+int zz_parse_int(const char *str, size_t length, struct zz_data *data);
+/**
+ * Parse a floating-point literal as accepted by strtod() in the C locale, into
+ * a correctly rounded ``ZZ_DOUBLE``. Returns 0 on success, or -1 if the text
+ * is not a valid literal.
+ */
+int zz_parse_double(const char *str, size_t length, struct zz_data *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif          // ZEBU_LITERAL_H_
@@ -5,6 +5,7 @@
 
 #include "list.h"
 #include "data.h"
+#include "source.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,6 +19,19 @@ extern "C" {
  *
  * Nodes are always handled by pointer, and managed by a zz_tree object, that
  * functions as a factory for each tree.
+ *
+ * Leaf nodes, created with zz_leaf(), are allocated without the list head of
+ * their children, that comes last in the struct for this purpose; they can be
+ * walked like any other node, and have no children, but can't be given any,
+ * nor extra fields.
+ *
+ * Every node has an id that is unique in its tree, and dense: ids are handed
+ * out from zero as nodes are created, and recycled nodes keep theirs, so they
+ * can index arrays of attributes like the columns in column.h.
+ *
+ * The span, flags and id take 16 bytes of every node, which has no padding to
+ * hide them in: a node takes 88 bytes, or 80 with ``ZZ_COMPACT_DATA``, and a
+ * leaf 16 bytes less.
  */
 
 /**
@@ -25,25 +39,64 @@ extern "C" {
  */
 struct zz_node {
 	struct zz_list siblings;
-	struct zz_list children;
 	struct zz_list allocated;
 	const char *token;
 	struct zz_data data;
+	struct zz_span span;
+	unsigned int flags;
+	unsigned int id;
+	struct zz_list children;
 };
 
+/**
+ * Node flags: leaves, nodes that zz_rewrite() found no rule for, and nodes in
+ * the index of their tree; the bits
+ * from ``ZZ_NODE_POOL_SHIFT`` up hold the size the tree gave the node when it
+ * was created, as the number of its pool, or 0 for the default size
+ */
+#define ZZ_NODE_LEAF 1
+#define ZZ_NODE_NORMAL 2
+#define ZZ_NODE_INDEXED 4
+#define ZZ_NODE_POOL_SHIFT 8
+
+/**
+ * Size of leaf nodes
+ */
+#define ZZ_LEAF_SIZE offsetof(struct zz_node, children)
+
+/**
+ * Empty list that stands for the children of leaf nodes
+ */
+extern struct zz_list zz_no_children;
+
+/**
+ * Check whether node is a leaf
+ */
+static inline int zz_is_leaf(const struct zz_node *n)
+{
+	return n->flags & ZZ_NODE_LEAF;
+}
+/**
+ * Get list of children of node
+ */
+static inline struct zz_list *zz_children(struct zz_node *n)
+{
+	return zz_is_leaf(n) ? &zz_no_children : &n->children;
+}
+
 /**
  * Iterate on children list, forward and backwards; the safe functions tike an
  * additional argument that is used as temporary storage and allows unlinking
  * the iterator inside the loop.
  */
 #define zz_foreach_child(iter, node) \
-zz_list_foreach_entry(iter, &node->children, siblings)
+zz_list_foreach_entry(iter, zz_children(node), siblings)
 #define zz_reverse_foreach_child(iter, node) \
-zz_list_reverse_foreach_entry(iter, &node->children, siblings)
+zz_list_reverse_foreach_entry(iter, zz_children(node), siblings)
 #define zz_foreach_child_safe(iter, temp, node) \
-zz_list_foreach_entry_safe(iter, temp, &node->children, siblings)
+zz_list_foreach_entry_safe(iter, temp, zz_children(node), siblings)
 #define zz_reverse_foreach_child_safe(iter, temp, node) \
-zz_list_reverse_foreach_entry_safe(iter, temp, &node->children, siblings)
+zz_list_reverse_foreach_entry_safe(iter, temp, zz_children(node), siblings)
 /**
  * Get next and previous sibling of node, or ``NULL`` if there isn't one
  */
@@ -64,22 +117,33 @@ static inline struct zz_node *zz_prev_sibling(struct zz_node *p, struct zz_node
  */
 static inline struct zz_node *zz_first_child(struct zz_node *n)
 {
-	if (n->children.next == &n->children)
+	struct zz_list *children = zz_children(n);
+
+	if (children->next == children)
 		return NULL;
-	return zz_list_entry(n->children.next, struct zz_node, siblings);
+	return zz_list_entry(children->next, struct zz_node, siblings);
 }
 static inline struct zz_node *zz_last_child(struct zz_node *n)
 {
-	if (n->children.prev == &n->children)
+	struct zz_list *children = zz_children(n);
+
+	if (children->prev == children)
 		return NULL;
-	return zz_list_entry(n->children.prev, struct zz_node, siblings);
+	return zz_list_entry(children->prev, struct zz_node, siblings);
 }
 /**
- * Destroy node and its children recursively
+ * Destroy node and its children recursively; the memory is released with
+ * free(), so this must not be used on trees with a custom allocator, nor on
+ * concurrent trees. Nodes of indexed trees are left alone, since the index
+ * would keep pointing to them. zz_recycle() works on any tree.
  */
 static inline void zz_destroy(struct zz_node *n)
 {
 	struct zz_node *i, *x;
+
+	assert(!(n->flags & ZZ_NODE_INDEXED));
+	if (n->flags & ZZ_NODE_INDEXED)
+		return;
 	zz_foreach_child_safe(i, x, n)
 		zz_destroy(i);
 	zz_list_unlink(&n->allocated);
@@ -87,15 +151,20 @@ static inline void zz_destroy(struct zz_node *n)
 	free(n);
 }
 /**
- * Append and prepend child to node
+ * Append and prepend child to node, that must not be a leaf; leaves have no
+ * room for children, so if it is one, nothing is done
  */
 static inline void zz_append_child(struct zz_node *p, struct zz_node *c)
 {
-	zz_list_append(&p->children, &c->siblings);
+	assert(!zz_is_leaf(p));
+	if (!zz_is_leaf(p))
+		zz_list_append(&p->children, &c->siblings);
 }
 static inline void zz_prepend_child(struct zz_node *p, struct zz_node *c)
 {
-	zz_list_prepend(&p->children, &c->siblings);
+	assert(!zz_is_leaf(p));
+	if (!zz_is_leaf(p))
+		zz_list_prepend(&p->children, &c->siblings);
 }
 /**
  * Remove node from its parent
@@ -104,32 +173,73 @@ static inline void zz_unlink_child(struct zz_node *n)
 {
 	zz_list_unlink(&n->siblings);
 }
+/**
+ * Remove node from its parent, if it has one, and return it; unlike
+ * zz_unlink_child() this can be called more than once on the same node.
+ */
+static inline struct zz_node *zz_take(struct zz_node *n)
+{
+	zz_list_unlink(&n->siblings);
+	zz_list_init(&n->siblings);
+	return n;
+}
+/**
+ * Set the span of node, or extend it to cover ``span`` too
+ */
+static inline void zz_set_span(struct zz_node *n, struct zz_span span)
+{
+	n->span = span;
+}
+static inline void zz_extend_span(struct zz_node *n, struct zz_span span)
+{
+	n->span = zz_span_join(n->span, span);
+}
 /**
  * Check type of payload
  */
 static inline int zz_is_null(struct zz_node *n)
 {
-	return n->data.type == ZZ_NULL;
+	return zz_data_type(n->data) == ZZ_NULL;
 }
 static inline int zz_is_int(struct zz_node *n)
 {
-	return n->data.type == ZZ_INT;
+	return zz_data_type(n->data) == ZZ_INT;
 }
 static inline int zz_is_uint(struct zz_node *n)
 {
-	return n->data.type == ZZ_UINT;
+	return zz_data_type(n->data) == ZZ_UINT;
 }
 static inline int zz_is_double(struct zz_node *n)
 {
-	return n->data.type == ZZ_DOUBLE;
+	return zz_data_type(n->data) == ZZ_DOUBLE;
 }
 static inline int zz_is_string(struct zz_node *n)
 {
-	return n->data.type == ZZ_STRING;
+	return zz_data_type(n->data) == ZZ_STRING;
+}
+static inline int zz_is_short_string(struct zz_node *n)
+{
+	return zz_data_type(n->data) == ZZ_SHORT_STRING;
 }
 static inline int zz_is_pointer(struct zz_node *n)
 {
-	return n->data.type == ZZ_POINTER;
+	return zz_data_type(n->data) == ZZ_POINTER;
+}
+static inline int zz_is_slice(struct zz_node *n)
+{
+	return zz_data_type(n->data) == ZZ_SLICE;
+}
+static inline int zz_is_int64(struct zz_node *n)
+{
+	return zz_data_type(n->data) == ZZ_INT64;
+}
+static inline int zz_is_uint64(struct zz_node *n)
+{
+	return zz_data_type(n->data) == ZZ_UINT64;
+}
+static inline int zz_is_blob(struct zz_node *n)
+{
+	return zz_data_type(n->data) == ZZ_BLOB;
 }
 /**
  * Cast node payload to specific type
@@ -148,14 +258,34 @@ static inline double zz_get_double(struct zz_node *n)
 }
 static inline const char *zz_get_string(struct zz_node *n)
 {
-	return zz_to_string(n->data);
+	return zz_data_string(&n->data);
 }
 static inline void *zz_get_pointer(struct zz_node *n)
 {
 	return zz_to_pointer(n->data);
 }
+#ifndef ZZ_COMPACT_DATA
+static inline const char *zz_get_slice(struct zz_node *n, size_t *length)
+{
+	return zz_to_slice(n->data, length);
+}
+static inline int64_t zz_get_int64(struct zz_node *n)
+{
+	return zz_to_int64(n->data);
+}
+static inline uint64_t zz_get_uint64(struct zz_node *n)
+{
+	return zz_to_uint64(n->data);
+}
+static inline const unsigned char *zz_get_blob(struct zz_node *n, size_t *length)
+{
+	return zz_to_blob(n->data, length);
+}
+#endif
 /**
- * Reset node payload to new data, destroying the old one
+ * Reset node payload to new data, destroying the old one; these don't know the
+ * tree of the node, so a blob payload must be replaced with zz_set_data()
+ * instead, or its storage is not reused until the tree is destroyed
  */
 static inline void zz_set_null(struct zz_node *n)
 {
@@ -187,6 +317,23 @@ static inline void zz_set_pointer(struct zz_node *n, void *d)
 	zz_data_destroy(n->data);
 	n->data = zz_pointer(d);
 }
+#ifndef ZZ_COMPACT_DATA
+static inline void zz_set_slice(struct zz_node *n, const char *d, size_t length)
+{
+	zz_data_destroy(n->data);
+	n->data = zz_slice(d, length);
+}
+static inline void zz_set_int64(struct zz_node *n, int64_t d)
+{
+	zz_data_destroy(n->data);
+	n->data = zz_int64(d);
+}
+static inline void zz_set_uint64(struct zz_node *n, uint64_t d)
+{
+	zz_data_destroy(n->data);
+	n->data = zz_uint64(d);
+}
+#endif
 
 #ifdef __cplusplus
 }
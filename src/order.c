@@ -0,0 +1,76 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "order.h"
+
+void zz_order_init(struct zz_order *order, const struct zz_allocator *allocator)
+{
+	order->root = NULL;
+	zz_column_init(&order->entries, sizeof(struct zz_order_entry),
+			allocator);
+	order->size = 0;
+	order->valid = 0;
+}
+
+void zz_order_destroy(struct zz_order *order)
+{
+	zz_column_destroy(&order->entries);
+	order->root = NULL;
+	order->size = 0;
+	order->valid = 0;
+}
+
+static inline struct zz_order_entry *entry(struct zz_order *order,
+		const struct zz_node *node)
+{
+	return zz_column_at(&order->entries, node);
+}
+
+/* Walk the subtree without a stack, climbing back through the parents that
+ * have already been recorded */
+void zz_order_build(struct zz_order *order, struct zz_node *root)
+{
+	struct zz_node *node, *parent, *next;
+	struct zz_order_entry *e;
+	unsigned int pre = 0, post = 0, depth = 0;
+
+	zz_column_clear(&order->entries);
+	order->root = root;
+	node = root;
+	parent = NULL;
+	for (;;) {
+		e = entry(order, node);
+		e->parent = parent;
+		e->pre = ++pre;
+		e->depth = depth;
+		next = zz_first_child(node);
+		if (next != NULL) {
+			parent = node;
+			node = next;
+			++depth;
+			continue;
+		}
+		for (;;) {
+			entry(order, node)->post = ++post;
+			if (node == root)
+				goto done;
+			next = zz_next_sibling(parent, node);
+			if (next != NULL)
+				break;
+			node = parent;
+			parent = entry(order, node)->parent;
+			--depth;
+		}
+		node = next;
+	}
+done:
+	order->size = pre;
+	order->valid = 1;
+}
+
+struct zz_node *zz_lca(const struct zz_order *order, struct zz_node *a,
+		struct zz_node *b)
+{
+	while (!zz_is_ancestor(order, a, b))
+		a = zz_parent(order, a);
+	return a;
+}
@@ -0,0 +1,131 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_ORDER_H_
+#define ZEBU_ORDER_H_
+
+#include "column.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Order
+ * -----
+ *
+ * Numbering of the nodes of a subtree in pre-order and post-order, so that
+ * checking whether a node is an ancestor of another takes two comparisons
+ * instead of a search. The numbers are kept in a column indexed by node id,
+ * together with the depth and the parent of every node, which nodes don't
+ * have on their own.
+ *
+ * Nodes don't know about the numberings of their tree, so editing the subtree
+ * with zz_append_child(), zz_unlink_child() and the like leaves them stale:
+ * the editor marks the numbering with zz_order_invalidate(), which is free,
+ * and zz_order_update() numbers the whole subtree again from scratch before
+ * the next queries, in time proportional to its size however small the edit
+ * was. Queries on a stale numbering are an error.
+ */
+
+/**
+ * Position of a node in the numbering; ``pre`` is 0 for nodes outside the
+ * subtree
+ */
+struct zz_order_entry {
+	struct zz_node *parent;
+	unsigned int pre;
+	unsigned int post;
+	unsigned int depth;
+};
+
+/**
+ * Numbering of the subtree under ``root``
+ */
+struct zz_order {
+	struct zz_node *root;
+	struct zz_column entries;
+	unsigned int size;
+	int valid;
+};
+
+/**
+ * Initialize an empty numbering, that takes its memory from ``allocator``
+ */
+void zz_order_init(struct zz_order *order, const struct zz_allocator *allocator);
+/**
+ * Free the numbering
+ */
+void zz_order_destroy(struct zz_order *order);
+/**
+ * Number the subtree under ``root``
+ */
+void zz_order_build(struct zz_order *order, struct zz_node *root);
+/**
+ * Mark the numbering as stale after the subtree has been edited
+ */
+static inline void zz_order_invalidate(struct zz_order *order)
+{
+	order->valid = 0;
+}
+/**
+ * Rebuild the numbering of the subtree if it is stale, in time proportional to
+ * its size; a numbering that was never built is left empty, and invalid
+ */
+static inline void zz_order_update(struct zz_order *order)
+{
+	if (!order->valid && order->root != NULL)
+		zz_order_build(order, order->root);
+}
+
+/**
+ * Get the position of ``node``, or ``NULL`` if it is outside the subtree
+ */
+static inline const struct zz_order_entry *zz_order_get(
+		const struct zz_order *order, const struct zz_node *node)
+{
+	const struct zz_order_entry *e;
+
+	assert(order->valid);
+	e = zz_column_get(&order->entries, node);
+	return e != NULL && e->pre != 0 ? e : NULL;
+}
+/**
+ * Check whether ``a`` is ``b`` or one of its ancestors; both must be in the
+ * subtree
+ */
+static inline int zz_is_ancestor(const struct zz_order *order,
+		const struct zz_node *a, const struct zz_node *b)
+{
+	const struct zz_order_entry *ea = zz_order_get(order, a);
+	const struct zz_order_entry *eb = zz_order_get(order, b);
+
+	return ea->pre <= eb->pre && eb->post <= ea->post;
+}
+/**
+ * Get depth of ``node`` in the subtree, where the root has depth 0
+ */
+static inline unsigned int zz_depth(const struct zz_order *order,
+		const struct zz_node *node)
+{
+	return zz_order_get(order, node)->depth;
+}
+/**
+ * Get parent of ``node``, or ``NULL`` for the root
+ */
+static inline struct zz_node *zz_parent(const struct zz_order *order,
+		const struct zz_node *node)
+{
+	return zz_order_get(order, node)->parent;
+}
+/**
+ * Get the lowest common ancestor of ``a`` and ``b``; takes time proportional
+ * to the distance from ``a`` to it.
+ */
+struct zz_node *zz_lca(const struct zz_order *order, struct zz_node *a,
+		struct zz_node *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif          // ZEBU_ORDER_H_
@@ -0,0 +1,468 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "parallel.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include "trace.h"
+
+struct worker {
+	struct pool *pool;
+	pthread_t thread;
+	unsigned int seed;
+	void *acc;
+	/* Private stack of pending nodes */
+	struct zz_node **stack;
+	size_t stack_size;
+	size_t stack_alloc;
+	/* Nodes published for other threads to steal */
+	pthread_mutex_t lock;
+	struct zz_node **shared;
+	size_t shared_head;
+	size_t shared_size;
+	size_t shared_alloc;
+};
+
+struct pool {
+	struct worker *workers;
+	size_t num_workers;
+	/* Number of published nodes plus number of busy workers; when it drops
+	 * to zero, the walk is over. */
+	size_t work;
+	void (*foreach)(struct zz_node *, void *);
+	void (*fn)(struct zz_node *, void *, void *);
+	void *data;
+};
+
+static void push(struct worker *w, struct zz_node *n)
+{
+	if (w->stack_size == w->stack_alloc) {
+		w->stack_alloc = w->stack_alloc ? w->stack_alloc * 2 : 64;
+		w->stack = realloc(w->stack, w->stack_alloc * sizeof(*w->stack));
+	}
+	w->stack[w->stack_size++] = n;
+}
+
+/* Move the bottom half of the private stack to the shared queue */
+static void publish(struct worker *w)
+{
+	size_t count = w->stack_size / 2;
+
+	__atomic_add_fetch(&w->pool->work, count, __ATOMIC_SEQ_CST);
+	pthread_mutex_lock(&w->lock);
+	if (w->shared_head + w->shared_size + count > w->shared_alloc) {
+		memmove(w->shared, w->shared + w->shared_head,
+				w->shared_size * sizeof(*w->shared));
+		w->shared_head = 0;
+		if (w->shared_size + count > w->shared_alloc) {
+			w->shared_alloc = (w->shared_size + count) * 2;
+			w->shared = realloc(w->shared,
+					w->shared_alloc * sizeof(*w->shared));
+		}
+	}
+	memcpy(w->shared + w->shared_head + w->shared_size, w->stack,
+			count * sizeof(*w->stack));
+	__atomic_store_n(&w->shared_size, w->shared_size + count,
+			__ATOMIC_RELEASE);
+	pthread_mutex_unlock(&w->lock);
+	memmove(w->stack, w->stack + count,
+			(w->stack_size - count) * sizeof(*w->stack));
+	w->stack_size -= count;
+}
+
+/* Take the oldest node published by ``victim`` */
+static struct zz_node *steal(struct worker *victim)
+{
+	struct zz_node *n = NULL;
+
+	if (__atomic_load_n(&victim->shared_size, __ATOMIC_ACQUIRE) == 0)
+		return NULL;
+	pthread_mutex_lock(&victim->lock);
+	if (victim->shared_size > 0) {
+		n = victim->shared[victim->shared_head++];
+		__atomic_store_n(&victim->shared_size, victim->shared_size - 1,
+				__ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&victim->lock);
+	return n;
+}
+
+static struct zz_node *find_work(struct worker *w)
+{
+	struct pool *p = w->pool;
+	struct zz_node *n;
+	size_t i, start;
+
+	for (;;) {
+		if ((n = steal(w)) != NULL)
+			return n;
+		w->seed = w->seed * 1103515245 + 12345;
+		start = w->seed >> 16;
+		for (i = 0; i < p->num_workers; ++i) {
+			n = steal(&p->workers[(start + i) % p->num_workers]);
+			if (n != NULL)
+				return n;
+		}
+		if (__atomic_load_n(&p->work, __ATOMIC_SEQ_CST) == 0)
+			return NULL;
+		sched_yield();
+	}
+}
+
+static void *run(void *arg)
+{
+	struct worker *w = arg;
+	struct pool *p = w->pool;
+	struct zz_node *n, *iter;
+
+	while ((n = find_work(w)) != NULL) {
+		/* Stealing a node makes the worker busy, so the counter is
+		 * left unchanged until the stack runs out. */
+		push(w, n);
+		while (w->stack_size > 0) {
+			n = w->stack[--w->stack_size];
+			if (p->foreach != NULL)
+				p->foreach(n, p->data);
+			else
+				p->fn(n, w->acc, p->data);
+			zz_reverse_foreach_child(iter, n)
+				push(w, iter);
+			if (w->stack_size > 1 && __atomic_load_n(&w->shared_size,
+						__ATOMIC_ACQUIRE) == 0)
+				publish(w);
+		}
+		__atomic_sub_fetch(&p->work, 1, __ATOMIC_SEQ_CST);
+	}
+	return NULL;
+}
+
+static void walk(struct pool *p, struct zz_node *root, size_t size,
+		const void *identity)
+{
+	struct worker *w;
+	size_t i;
+
+	assert(p->num_workers > 0);
+	p->workers = calloc(p->num_workers, sizeof(*p->workers));
+	for (i = 0; i < p->num_workers; ++i) {
+		w = &p->workers[i];
+		w->pool = p;
+		w->seed = i;
+		if (size > 0) {
+			w->acc = malloc(size);
+			memcpy(w->acc, identity, size);
+		}
+		pthread_mutex_init(&w->lock, NULL);
+	}
+	w = &p->workers[0];
+	w->shared_alloc = 1;
+	w->shared = calloc(1, sizeof(*w->shared));
+	w->shared[0] = root;
+	w->shared_size = 1;
+	p->work = 1;
+
+	for (i = 1; i < p->num_workers; ++i)
+		pthread_create(&p->workers[i].thread, NULL, run, &p->workers[i]);
+	run(&p->workers[0]);
+	for (i = 1; i < p->num_workers; ++i)
+		pthread_join(p->workers[i].thread, NULL);
+}
+
+static void walk_destroy(struct pool *p)
+{
+	size_t i;
+
+	for (i = 0; i < p->num_workers; ++i) {
+		pthread_mutex_destroy(&p->workers[i].lock);
+		free(p->workers[i].stack);
+		free(p->workers[i].shared);
+		free(p->workers[i].acc);
+	}
+	free(p->workers);
+}
+
+void zz_parallel_foreach(struct zz_node *root, size_t num_threads,
+		void (*fn)(struct zz_node *, void *), void *data)
+{
+	struct pool p = { NULL, num_threads, 0, fn, NULL, data };
+
+	walk(&p, root, 0, NULL);
+	walk_destroy(&p);
+}
+
+void zz_parallel_reduce(struct zz_node *root, size_t num_threads,
+		size_t size, void *result,
+		void (*fn)(struct zz_node *, void *, void *),
+		void (*merge)(void *, const void *, void *), void *data)
+{
+	struct pool p = { NULL, num_threads, 0, NULL, fn, data };
+	size_t i;
+
+	walk(&p, root, size, result);
+	for (i = 0; i < p.num_workers; ++i)
+		merge(result, p.workers[i].acc, data);
+	walk_destroy(&p);
+}
+
+struct batch {
+	struct zz_data *data;
+	size_t size;
+	size_t alloc;
+};
+
+static void batch_add(struct batch *b, struct zz_data data)
+{
+	if (zz_data_type(data) != ZZ_STRING)
+		return;
+	if (b->size == b->alloc) {
+		b->alloc = b->alloc ? b->alloc * 2 : 256;
+		b->data = realloc(b->data, b->alloc * sizeof(*b->data));
+	}
+	b->data[b->size++] = data;
+}
+
+/* Node ids are taken from the destination tree in blocks of this size */
+#define COPIER_IDS 256
+
+struct copier {
+	pthread_t thread;
+	struct zz_tree tree;
+	struct zz_tree *dst;
+	unsigned int next_id;
+	unsigned int end_id;
+	struct batch strings;
+	struct zz_node **frontier;
+	struct zz_node **copies;
+	size_t num_frontier;
+	size_t *next;
+};
+
+static unsigned int copier_id(struct copier *c)
+{
+	if (c->next_id == c->end_id) {
+		c->next_id = __atomic_fetch_add(&c->dst->next_node_id,
+				COPIER_IDS, __ATOMIC_RELAXED);
+		c->end_id = c->next_id + COPIER_IDS;
+	}
+	return c->next_id++;
+}
+
+/* Copy payloads without touching the string dictionary; references are taken
+ * all at once when the copy is done. Nodes are renumbered with ids of the
+ * destination tree. */
+static struct zz_node *copy_subtree(struct copier *c, struct zz_node *node)
+{
+	struct zz_node *ret, *iter;
+
+	if (zz_is_blob(node)) {
+		ret = zz_copy(&c->tree, node);
+	} else {
+		if (zz_is_leaf(node))
+			ret = zz_leaf(&c->tree, node->token, node->data);
+		else
+			ret = zz_node(&c->tree, node->token, node->data);
+		ret->span = node->span;
+		batch_add(&c->strings, node->data);
+	}
+	ret->id = copier_id(c);
+	zz_foreach_child(iter, node)
+		zz_append_child(ret, copy_subtree(c, iter));
+	return ret;
+}
+
+/* Give tree the token sizes of src, creating the pools in the same order so
+ * that nodes keep the numbers of their pools when the trees are merged */
+static void copy_token_sizes(struct zz_tree *tree, const struct zz_tree *src)
+{
+	struct zz_tree_pool *pool;
+	size_t i, j;
+
+	for (i = 0; i < src->num_pools; ++i) {
+		pool = src->pools[i];
+		for (j = 0; j < src->token_sizes_alloc; ++j)
+			if (src->token_sizes[j].pool == pool)
+				zz_tree_set_token_size(tree,
+						src->token_sizes[j].token,
+						pool->size);
+	}
+}
+
+static void *run_copier(void *arg)
+{
+	struct copier *c = arg;
+	size_t i;
+
+	while ((i = __atomic_fetch_add(c->next, 1, __ATOMIC_RELAXED)) <
+			c->num_frontier)
+		c->copies[i] = copy_subtree(c, c->frontier[i]);
+	zz_data_ref_batch(c->strings.data, c->strings.size);
+	return NULL;
+}
+
+struct zz_node *zz_copy_recursive_parallel(struct zz_tree *tree,
+		struct zz_node *node, size_t num_threads)
+{
+	struct zz_node **nodes, **copies, *iter;
+	struct zz_list *markers;
+	struct copier *copiers;
+	size_t *parents, num_nodes, alloc, expanded, target, next, i;
+
+	if (num_threads <= 1)
+		return zz_copy_recursive(tree, node);
+
+	/* Expand the tree breadth-first until there are enough subtrees to
+	 * keep all threads busy */
+	target = num_threads * 8;
+	alloc = target * 2;
+	nodes = malloc(alloc * sizeof(*nodes));
+	parents = malloc(alloc * sizeof(*parents));
+	nodes[0] = node;
+	parents[0] = 0;
+	num_nodes = 1;
+	for (expanded = 0; expanded < num_nodes &&
+			num_nodes - expanded < target; ++expanded) {
+		zz_foreach_child(iter, nodes[expanded]) {
+			if (num_nodes == alloc) {
+				alloc *= 2;
+				nodes = realloc(nodes, alloc * sizeof(*nodes));
+				parents = realloc(parents, alloc * sizeof(*parents));
+			}
+			nodes[num_nodes] = iter;
+			parents[num_nodes++] = expanded;
+		}
+	}
+
+	/* Copy the expanded nodes, leaving markers in place of the subtrees
+	 * below them */
+	copies = malloc(num_nodes * sizeof(*copies));
+	markers = malloc((num_nodes - expanded + 1) * sizeof(*markers));
+	for (i = 0; i < num_nodes; ++i) {
+		if (i < expanded) {
+			copies[i] = zz_copy(tree, nodes[i]);
+			if (i > 0)
+				zz_append_child(copies[parents[i]], copies[i]);
+		} else {
+			zz_list_append(&copies[parents[i]]->children,
+					&markers[i - expanded]);
+		}
+	}
+
+	next = 0;
+	copiers = calloc(num_threads, sizeof(*copiers));
+	for (i = 0; i < num_threads; ++i) {
+		zz_tree_init(&copiers[i].tree, tree->node_size);
+		zz_tree_set_allocator(&copiers[i].tree, tree->allocator);
+		copy_token_sizes(&copiers[i].tree, tree);
+		copiers[i].dst = tree;
+		copiers[i].frontier = nodes + expanded;
+		copiers[i].copies = copies + expanded;
+		copiers[i].num_frontier = num_nodes - expanded;
+		copiers[i].next = &next;
+		if (i > 0)
+			pthread_create(&copiers[i].thread, NULL, run_copier,
+					&copiers[i]);
+	}
+	run_copier(&copiers[0]);
+	for (i = 0; i < num_threads; ++i) {
+		if (i > 0)
+			pthread_join(copiers[i].thread, NULL);
+		zz_tree_merge(tree, &copiers[i].tree);
+		zz_tree_destroy(&copiers[i].tree);
+		free(copiers[i].strings.data);
+	}
+	for (i = expanded; i < num_nodes; ++i) {
+		zz_list_insert(&markers[i - expanded], &copies[i]->siblings);
+		zz_list_unlink(&markers[i - expanded]);
+	}
+
+	node = copies[0];
+	free(copiers);
+	free(markers);
+	free(copies);
+	free(parents);
+	free(nodes);
+	return node;
+}
+
+/* Nodes a destroyer claims from the list at a time */
+#define DESTROYER_NODES 1024
+
+/* The list of live nodes is shared by all destroyers: each one takes the next
+ * segment by walking it under the lock, and frees it while the others walk,
+ * so that every node is only brought into cache by the thread that frees it */
+struct teardown {
+	struct zz_tree *tree;
+	pthread_mutex_t lock;
+	struct zz_list *next;
+};
+
+struct destroyer {
+	pthread_t thread;
+	struct teardown *shared;
+	struct batch strings;
+};
+
+static void *run_destroyer(void *arg)
+{
+	struct destroyer *d = arg;
+	struct teardown *s = d->shared;
+	struct zz_list *first, *iter, *next;
+	struct zz_node *n;
+	size_t i;
+
+	for (;;) {
+		pthread_mutex_lock(&s->lock);
+		first = iter = s->next;
+		for (i = 0; i < DESTROYER_NODES && iter != &s->tree->nodes; ++i)
+			iter = iter->next;
+		s->next = iter;
+		pthread_mutex_unlock(&s->lock);
+		if (first == iter)
+			break;
+		for (; first != iter; first = next) {
+			next = first->next;
+			n = zz_list_entry(first, struct zz_node, allocated);
+			batch_add(&d->strings, n->data);
+			zz_free(s->tree->allocator, n,
+					zz_tree_sizeof(s->tree, n));
+		}
+	}
+	zz_data_destroy_batch(d->strings.data, d->strings.size);
+	free(d->strings.data);
+	return NULL;
+}
+
+void zz_tree_destroy_parallel(struct zz_tree *tree, size_t num_threads)
+{
+	struct teardown shared;
+	struct destroyer *destroyers;
+	size_t i;
+
+	zz_tree_sync(tree);
+	if (num_threads <= 1 || tree->num_nodes < num_threads * 1024) {
+		zz_tree_destroy(tree);
+		return;
+	}
+
+	ZZ_TRACE(ZZ_EVENT_DESTROY, tree_destroy, tree, tree->num_nodes);
+	shared.tree = tree;
+	pthread_mutex_init(&shared.lock, NULL);
+	shared.next = tree->nodes.next;
+	destroyers = calloc(num_threads, sizeof(*destroyers));
+	for (i = 0; i < num_threads; ++i) {
+		destroyers[i].shared = &shared;
+		if (i > 0)
+			pthread_create(&destroyers[i].thread, NULL,
+					run_destroyer, &destroyers[i]);
+	}
+	run_destroyer(&destroyers[0]);
+	for (i = 1; i < num_threads; ++i)
+		pthread_join(destroyers[i].thread, NULL);
+	free(destroyers);
+	pthread_mutex_destroy(&shared.lock);
+
+	zz_tree_release(tree);
+	ZZ_TRACE(ZZ_EVENT_DESTROYED, tree_destroyed, tree, tree->num_nodes);
+}
@@ -0,0 +1,63 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_PARALLEL_H_
+#define ZEBU_PARALLEL_H_
+
+#include "tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Parallel
+ * --------
+ *
+ * Walk a tree with a pool of threads.
+ *
+ * Every thread walks its own part of the tree depth-first, and whenever it has
+ * pending subtrees and nobody is waiting for work from it, it publishes the
+ * ones closest to the root, that are likely to be the largest, so that idle
+ * threads can steal them. Nodes are visited in no particular order, and the
+ * tree must not be modified during the walk.
+ */
+
+/**
+ * Call ``fn`` on every node of the tree whose root is ``root``, using up to
+ * ``num_threads`` threads, including the calling one; ``data`` is passed as
+ * the second argument to ``fn``, that must be safe to call concurrently.
+ */
+void zz_parallel_foreach(struct zz_node *root, size_t num_threads,
+		void (*fn)(struct zz_node *, void *), void *data);
+/**
+ * Reduce the tree whose root is ``root`` to a single value of ``size`` bytes,
+ * using up to ``num_threads`` threads, including the calling one.
+ *
+ * ``result`` must hold the identity value on entry; every thread starts with
+ * its own copy of it, and calls ``fn`` to accumulate each node it visits into
+ * it. When all nodes have been visited, each of the per-thread values is
+ * combined into ``result`` with ``merge``, that must be associative and
+ * commutative. ``data`` is passed as the last argument to both functions.
+ */
+void zz_parallel_reduce(struct zz_node *root, size_t num_threads,
+		size_t size, void *result,
+		void (*fn)(struct zz_node *, void *, void *),
+		void (*merge)(void *, const void *, void *), void *data);
+/**
+ * Same as zz_copy_recursive(), but the subtrees below the first few levels of
+ * the tree are copied by up to ``num_threads`` threads, each of them into its
+ * own nodes, and then linked into ``tree``.
+ */
+struct zz_node *zz_copy_recursive_parallel(struct zz_tree *tree,
+		struct zz_node *node, size_t num_threads);
+/**
+ * Same as zz_tree_destroy(), but nodes are freed by up to ``num_threads``
+ * threads.
+ */
+void zz_tree_destroy_parallel(struct zz_tree *tree, size_t num_threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif          // ZEBU_PARALLEL_H_
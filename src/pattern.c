@@ -0,0 +1,590 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "pattern.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "literal.h"
+
+void zz_patterns_init(struct zz_patterns *set, const char *const *tokens,
+		size_t num_tokens)
+{
+	set->tokens = tokens;
+	set->num_tokens = num_tokens;
+	set->patterns = NULL;
+	set->num_patterns = 0;
+	set->states = calloc(1, sizeof(*set->states));
+	set->num_states = 1;
+	set->states_alloc = 1;
+	set->max_length = 0;
+	set->max_arity = 0;
+	set->max_vars = 0;
+}
+
+void zz_patterns_destroy(struct zz_patterns *set)
+{
+	struct zz_pattern_state *st;
+	size_t i, j;
+
+	for (i = 0; i < set->num_states; ++i) {
+		st = &set->states[i];
+		for (j = 0; j < st->num_edges; ++j)
+			zz_data_destroy(st->edges[j].item.payload);
+		free(st->edges);
+		free(st->accepts);
+	}
+	free(set->states);
+	for (i = 0; i < set->num_patterns; ++i) {
+		for (j = 0; j < set->patterns[i].num_vars; ++j)
+			free(set->patterns[i].vars[j]);
+		free(set->patterns[i].vars);
+		free(set->patterns[i].occurrences);
+		free(set->patterns[i].positions);
+	}
+	free(set->patterns);
+}
+
+/* Pattern being compiled */
+struct parser {
+	const struct zz_patterns *set;
+	const char *p;
+	struct zz_pattern_item *items;
+	unsigned int num_items;
+	unsigned int items_alloc;
+	struct zz_pattern pattern;
+	unsigned int vars_alloc;
+	unsigned int occurrences_alloc;
+	unsigned int max_arity;
+};
+
+static inline int is_name_char(char c)
+{
+	return c != '\0' && c != '[' && c != ']' && c != '"' &&
+		!isspace((unsigned char)c);
+}
+
+static void skip_space(struct parser *p)
+{
+	while (isspace((unsigned char)*p->p))
+		++p->p;
+}
+
+static size_t read_name(struct parser *p, const char **name)
+{
+	*name = p->p;
+	while (is_name_char(*p->p))
+		++p->p;
+	return p->p - *name;
+}
+
+static struct zz_pattern_item *push_item(struct parser *p)
+{
+	struct zz_pattern_item *item;
+
+	if (p->num_items == p->items_alloc) {
+		p->items_alloc = p->items_alloc ? p->items_alloc * 2 : 16;
+		p->items = realloc(p->items, p->items_alloc * sizeof(*p->items));
+	}
+	item = &p->items[p->num_items++];
+	memset(item, 0, sizeof(*item));
+	item->payload = zz_null;
+	return item;
+}
+
+static void push_var(struct parser *p, const char *name, size_t length)
+{
+	struct zz_pattern *pat = &p->pattern;
+	unsigned int i;
+
+	for (i = 0; i < pat->num_vars; ++i)
+		if (strncmp(pat->vars[i], name, length) == 0 &&
+				pat->vars[i][length] == '\0')
+			break;
+	if (i == pat->num_vars) {
+		if (pat->num_vars == p->vars_alloc) {
+			p->vars_alloc = p->vars_alloc ? p->vars_alloc * 2 : 4;
+			pat->vars = realloc(pat->vars,
+					p->vars_alloc * sizeof(*pat->vars));
+		}
+		pat->vars[pat->num_vars++] = strndup(name, length);
+	}
+	if (pat->num_occurrences == p->occurrences_alloc) {
+		p->occurrences_alloc = p->occurrences_alloc ?
+			p->occurrences_alloc * 2 : 4;
+		pat->occurrences = realloc(pat->occurrences,
+				p->occurrences_alloc * sizeof(*pat->occurrences));
+		pat->positions = realloc(pat->positions,
+				p->occurrences_alloc * sizeof(*pat->positions));
+	}
+	pat->occurrences[pat->num_occurrences] = i;
+	pat->positions[pat->num_occurrences++] = p->num_items;
+	push_item(p)->skip = 1;
+}
+
+static int parse_string(struct parser *p, struct zz_data *data)
+{
+	char *buf, *out;
+	const char *in;
+
+	buf = malloc(strlen(p->p) + 1);
+	out = buf;
+	for (in = p->p + 1; *in != '"'; ++in) {
+		if (*in == '\\' && in[1] != '\0')
+			++in;
+		if (*in == '\0') {
+			free(buf);
+			return -1;
+		}
+		*out++ = *in;
+	}
+	*out = '\0';
+	*data = zz_string(buf);
+	free(buf);
+	p->p = in + 1;
+	return 0;
+}
+
+static int parse_number(struct parser *p, struct zz_data *data)
+{
+	const char *number;
+	size_t length;
+
+	length = read_name(p, &number);
+	if (zz_parse_int(number, length, data) == 0)
+		return 0;
+	return zz_parse_double(number, length, data);
+}
+
+static int is_number(const char *s)
+{
+	if (*s == '-' || *s == '+')
+		++s;
+	if (*s == '.')
+		++s;
+	return isdigit((unsigned char)*s);
+}
+
+static int parse_subtree(struct parser *p);
+
+static int parse_node(struct parser *p)
+{
+	struct zz_pattern_item *item;
+	const char *name;
+	size_t length, i, index;
+	unsigned int arity = 0;
+
+	++p->p;
+	skip_space(p);
+	length = read_name(p, &name);
+	if (length == 0)
+		return -1;
+	index = p->num_items;
+	item = push_item(p);
+	if (length == 1 && name[0] == '_') {
+		item->any_token = 1;
+	} else {
+		for (i = 0; i < p->set->num_tokens; ++i)
+			if (strncmp(p->set->tokens[i], name, length) == 0 &&
+					p->set->tokens[i][length] == '\0')
+				break;
+		if (i == p->set->num_tokens)
+			return -1;
+		item->token = p->set->tokens[i];
+	}
+	skip_space(p);
+	if (*p->p == '"' || is_number(p->p)) {
+		if ((*p->p == '"' ? parse_string(p, &item->payload) :
+					parse_number(p, &item->payload)) < 0)
+			return -1;
+		item->has_payload = 1;
+	}
+	for (;;) {
+		skip_space(p);
+		if (*p->p == ']')
+			break;
+		if (parse_subtree(p) < 0)
+			return -1;
+		++arity;
+	}
+	++p->p;
+	p->items[index].arity = arity;
+	if (arity > p->max_arity)
+		p->max_arity = arity;
+	return 0;
+}
+
+static int parse_subtree(struct parser *p)
+{
+	const char *name;
+	size_t length;
+
+	skip_space(p);
+	if (*p->p == '[')
+		return parse_node(p);
+	length = read_name(p, &name);
+	if (length == 0)
+		return -1;
+	if (length == 1 && name[0] == '_')
+		push_item(p)->skip = 1;
+	else
+		push_var(p, name, length);
+	return 0;
+}
+
+static void free_parser(struct parser *p)
+{
+	unsigned int i;
+
+	for (i = 0; i < p->num_items; ++i)
+		zz_data_destroy(p->items[i].payload);
+	free(p->items);
+	for (i = 0; i < p->pattern.num_vars; ++i)
+		free(p->pattern.vars[i]);
+	free(p->pattern.vars);
+	free(p->pattern.occurrences);
+	free(p->pattern.positions);
+}
+
+static int item_equal(const struct zz_pattern_item *a,
+		const struct zz_pattern_item *b)
+{
+	if (a->skip || b->skip)
+		return a->skip == b->skip;
+	return a->any_token == b->any_token && a->token == b->token &&
+		a->arity == b->arity && a->has_payload == b->has_payload &&
+		(!a->has_payload ||
+		 (zz_data_type(a->payload) == zz_data_type(b->payload) &&
+		  zz_data_equal(a->payload, b->payload)));
+}
+
+static size_t add_state(struct zz_patterns *set)
+{
+	if (set->num_states == set->states_alloc) {
+		set->states_alloc *= 2;
+		set->states = realloc(set->states,
+				set->states_alloc * sizeof(*set->states));
+	}
+	memset(&set->states[set->num_states], 0, sizeof(*set->states));
+	return set->num_states++;
+}
+
+/* Follow the transition for item from state, adding it if there is none */
+static size_t add_transition(struct zz_patterns *set, size_t state,
+		struct zz_pattern_item *item)
+{
+	struct zz_pattern_state *st = &set->states[state];
+	struct zz_pattern_edge *e;
+	size_t i, target;
+
+	for (i = 0; i < st->num_edges; ++i) {
+		if (item_equal(&st->edges[i].item, item)) {
+			zz_data_destroy(item->payload);
+			return st->edges[i].target;
+		}
+	}
+	target = add_state(set);
+	st = &set->states[state];
+	if (st->num_edges == st->edges_alloc) {
+		st->edges_alloc = st->edges_alloc ? st->edges_alloc * 2 : 4;
+		st->edges = realloc(st->edges,
+				st->edges_alloc * sizeof(*st->edges));
+	}
+	e = &st->edges[st->num_edges++];
+	e->item = *item;
+	e->target = target;
+	return target;
+}
+
+int zz_pattern_add(struct zz_patterns *set, const char *pattern)
+{
+	struct zz_pattern_state *st;
+	struct parser p;
+	size_t state;
+	unsigned int i;
+
+	memset(&p, 0, sizeof(p));
+	p.set = set;
+	p.p = pattern;
+	if (parse_subtree(&p) < 0) {
+		free_parser(&p);
+		return -1;
+	}
+	skip_space(&p);
+	if (*p.p != '\0') {
+		free_parser(&p);
+		return -1;
+	}
+
+	state = 0;
+	for (i = 0; i < p.num_items; ++i)
+		state = add_transition(set, state, &p.items[i]);
+	free(p.items);
+	st = &set->states[state];
+	st->accepts = realloc(st->accepts,
+			(st->num_accepts + 1) * sizeof(*st->accepts));
+	st->accepts[st->num_accepts++] = set->num_patterns;
+
+	set->patterns = realloc(set->patterns,
+			(set->num_patterns + 1) * sizeof(*set->patterns));
+	set->patterns[set->num_patterns] = p.pattern;
+	if (p.num_items > set->max_length)
+		set->max_length = p.num_items;
+	if (p.max_arity > set->max_arity)
+		set->max_arity = p.max_arity;
+	if (p.pattern.num_vars > set->max_vars)
+		set->max_vars = p.pattern.num_vars;
+	return set->num_patterns++;
+}
+
+int zz_pattern_var(const struct zz_patterns *set, unsigned int pattern,
+		const char *name)
+{
+	const struct zz_pattern *pat = &set->patterns[pattern];
+	unsigned int i;
+
+	for (i = 0; i < pat->num_vars; ++i)
+		if (strcmp(pat->vars[i], name) == 0)
+			return i;
+	return -1;
+}
+
+/* Nodes still to be matched, in pre-order of the pattern */
+struct pending {
+	struct zz_node *node;
+	const struct pending *next;
+};
+
+struct matcher {
+	const struct zz_patterns *set;
+	struct zz_node **subjects;
+	struct zz_node **bindings;
+	int (*fn)(struct zz_node *, const struct zz_match *, void *);
+	void *data;
+	struct zz_node *node;
+	size_t count;
+	int stop;
+};
+
+/* Pair of nodes being compared, and their next children */
+struct pair {
+	struct zz_node *a;
+	struct zz_node *b;
+	struct zz_node *x;
+	struct zz_node *y;
+};
+
+static int node_equal(struct zz_node *a, struct zz_node *b)
+{
+	return a->token == b->token && zz_data_equal(a->data, b->data);
+}
+
+/* Compare both subtrees in pre-order, with a stack of the pairs of ancestors
+ * instead of recursion, that only goes to the heap for deep subtrees */
+static int subtree_equal(struct zz_node *a, struct zz_node *b)
+{
+	struct pair local[32], *stack = local, *f;
+	struct zz_node *x, *y;
+	size_t size = 0, alloc = sizeof(local) / sizeof(local[0]);
+	int ret = 1;
+
+	if (!node_equal(a, b))
+		return 0;
+	stack[size++] = (struct pair){ a, b, zz_first_child(a),
+		zz_first_child(b) };
+	while (size > 0) {
+		f = &stack[size - 1];
+		if (f->x == NULL || f->y == NULL) {
+			if (f->x != f->y) {
+				ret = 0;
+				break;
+			}
+			--size;
+			continue;
+		}
+		x = f->x;
+		y = f->y;
+		f->x = zz_next_sibling(f->a, x);
+		f->y = zz_next_sibling(f->b, y);
+		if (!node_equal(x, y)) {
+			ret = 0;
+			break;
+		}
+		if (size == alloc) {
+			alloc *= 2;
+			if (stack == local) {
+				stack = malloc(alloc * sizeof(*stack));
+				memcpy(stack, local, sizeof(local));
+			} else {
+				stack = realloc(stack, alloc * sizeof(*stack));
+			}
+		}
+		stack[size++] = (struct pair){ x, y, zz_first_child(x),
+			zz_first_child(y) };
+	}
+	if (stack != local)
+		free(stack);
+	return ret;
+}
+
+static void accept(struct matcher *m, const struct zz_pattern_state *st)
+{
+	const struct zz_pattern *pat;
+	struct zz_match match;
+	struct zz_node *subject;
+	unsigned int i, j, var;
+
+	for (i = 0; i < st->num_accepts && !m->stop; ++i) {
+		pat = &m->set->patterns[st->accepts[i]];
+		memset(m->bindings, 0, pat->num_vars * sizeof(*m->bindings));
+		for (j = 0; j < pat->num_occurrences; ++j) {
+			var = pat->occurrences[j];
+			subject = m->subjects[pat->positions[j]];
+			if (m->bindings[var] == NULL)
+				m->bindings[var] = subject;
+			else if (!subtree_equal(m->bindings[var], subject))
+				break;
+		}
+		if (j < pat->num_occurrences)
+			continue;
+		match.pattern = st->accepts[i];
+		match.bindings = m->bindings;
+		match.num_bindings = pat->num_vars;
+		++m->count;
+		if (m->fn(m->node, &match, m->data))
+			m->stop = 1;
+	}
+}
+
+/* Count the children of node, up to one more than max */
+static unsigned int count_children(struct zz_node *node, unsigned int max)
+{
+	struct zz_node *iter;
+	unsigned int ret = 0;
+
+	zz_foreach_child(iter, node)
+		if (++ret > max)
+			break;
+	return ret;
+}
+
+static int item_matches(const struct zz_pattern_item *item,
+		struct zz_node *node, unsigned int arity)
+{
+	return (item->any_token || item->token == node->token) &&
+		item->arity == arity &&
+		(!item->has_payload || zz_data_equal(item->payload, node->data));
+}
+
+static void run(struct matcher *m, size_t state, const struct pending *pending,
+		unsigned int pos)
+{
+	const struct zz_pattern_state *st = &m->set->states[state];
+	const struct zz_pattern_edge *e;
+	struct zz_node *node, *iter;
+	unsigned int arity = 0, i, j;
+	int counted = 0;
+
+	if (pending == NULL) {
+		accept(m, st);
+		return;
+	}
+	node = pending->node;
+	m->subjects[pos] = node;
+	for (i = 0; i < st->num_edges && !m->stop; ++i) {
+		e = &st->edges[i];
+		if (e->item.skip) {
+			run(m, e->target, pending->next, pos + 1);
+			continue;
+		}
+		if (!counted) {
+			arity = count_children(node, m->set->max_arity);
+			counted = 1;
+		}
+		if (!item_matches(&e->item, node, arity))
+			continue;
+		if (arity == 0) {
+			run(m, e->target, pending->next, pos + 1);
+		} else {
+			struct pending frames[arity];
+
+			j = 0;
+			zz_foreach_child(iter, node) {
+				frames[j].node = iter;
+				frames[j].next = j + 1 < arity ?
+					&frames[j + 1] : pending->next;
+				++j;
+			}
+			run(m, e->target, frames, pos + 1);
+		}
+	}
+}
+
+static void match_node(struct matcher *m, struct zz_node *node)
+{
+	struct pending root = { node, NULL };
+
+	m->node = node;
+	run(m, 0, &root, 0);
+}
+
+size_t zz_match(const struct zz_patterns *set, struct zz_node *node,
+		int (*fn)(struct zz_node *, const struct zz_match *, void *),
+		void *data)
+{
+	struct zz_node *subjects[set->max_length + 1];
+	struct zz_node *bindings[set->max_vars + 1];
+	struct matcher m = { set, subjects, bindings, fn, data, NULL, 0, 0 };
+
+	match_node(&m, node);
+	return m.count;
+}
+
+/* Node whose subtree is being matched, and its next child */
+struct frame {
+	struct zz_node *node;
+	struct zz_node *child;
+};
+
+/* Match every node of the subtree, in pre-order */
+static void match_subtree(struct matcher *m, struct zz_node *root)
+{
+	struct frame *stack, *f;
+	struct zz_node *node;
+	size_t size = 0, alloc = 64;
+
+	stack = malloc(alloc * sizeof(*stack));
+	match_node(m, root);
+	stack[size].node = root;
+	stack[size++].child = zz_first_child(root);
+	while (size > 0 && !m->stop) {
+		f = &stack[size - 1];
+		if (f->child == NULL) {
+			--size;
+			continue;
+		}
+		node = f->child;
+		f->child = zz_next_sibling(f->node, node);
+		match_node(m, node);
+		if (size == alloc) {
+			alloc *= 2;
+			stack = realloc(stack, alloc * sizeof(*stack));
+		}
+		stack[size].node = node;
+		stack[size++].child = zz_first_child(node);
+	}
+	free(stack);
+}
+
+size_t zz_match_tree(const struct zz_patterns *set, struct zz_node *root,
+		int (*fn)(struct zz_node *, const struct zz_match *, void *),
+		void *data)
+{
+	struct zz_node *subjects[set->max_length + 1];
+	struct zz_node *bindings[set->max_vars + 1];
+	struct matcher m = { set, subjects, bindings, fn, data, NULL, 0, 0 };
+
+	match_subtree(&m, root);
+	return m.count;
+}
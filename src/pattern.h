@@ -0,0 +1,149 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_PATTERN_H_
+#define ZEBU_PATTERN_H_
+
+#include "node.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Patterns
+ * --------
+ *
+ * Patterns describe the shape of a subtree with the syntax of zz_print(): a
+ * node is written as ``[token payload children...]``, where the payload can be
+ * an integer, a double or a string in double quotes, and matches nodes with an
+ * equal payload as per zz_data_equal(), or be left out to match any payload.
+ * Token names are looked up in the table given to the set; ``_`` stands for
+ * any token in the place of a token, and for any subtree in the place of a
+ * child. Any other name in the place of a child is a variable, that matches
+ * any subtree and is bound to it; a variable that appears more than once only
+ * matches subtrees that are equal. A node in a pattern only matches nodes with
+ * exactly as many children. For example::
+ *
+ *     [mul [num 0] _]
+ *     [add x x]
+ *     [call [ident "printf"] args]
+ *
+ * All the patterns of a set are compiled into one automaton: each pattern is
+ * flattened in pre-order, and the flattened patterns are merged into a trie,
+ * so the patterns that begin alike are tested together, and testing a node
+ * against the whole set takes one pass over it instead of one per pattern.
+ */
+
+/**
+ * Step of a flattened pattern: a node, or a subtree to skip
+ */
+struct zz_pattern_item {
+	const char *token;
+	struct zz_data payload;
+	unsigned int arity;
+	unsigned char skip;
+	unsigned char any_token;
+	unsigned char has_payload;
+};
+
+/**
+ * Transition of the automaton
+ */
+struct zz_pattern_edge {
+	struct zz_pattern_item item;
+	size_t target;
+};
+
+/**
+ * State of the automaton, and the patterns that match when it is reached
+ */
+struct zz_pattern_state {
+	struct zz_pattern_edge *edges;
+	size_t num_edges;
+	size_t edges_alloc;
+	unsigned int *accepts;
+	size_t num_accepts;
+};
+
+/**
+ * Pattern of a set: the names of its variables, in order of appearance, and
+ * the position in the flattened pattern of every occurrence of them
+ */
+struct zz_pattern {
+	char **vars;
+	unsigned int num_vars;
+	unsigned int *occurrences;
+	unsigned int *positions;
+	unsigned int num_occurrences;
+};
+
+/**
+ * Set of patterns compiled into an automaton
+ */
+struct zz_patterns {
+	const char *const *tokens;
+	size_t num_tokens;
+	struct zz_pattern *patterns;
+	unsigned int num_patterns;
+	struct zz_pattern_state *states;
+	size_t num_states;
+	size_t states_alloc;
+	unsigned int max_length;
+	unsigned int max_arity;
+	unsigned int max_vars;
+};
+
+/**
+ * Match of a pattern, with the subtrees bound to each of its variables
+ */
+struct zz_match {
+	unsigned int pattern;
+	struct zz_node *const *bindings;
+	unsigned int num_bindings;
+};
+
+/**
+ * Initialize an empty set of patterns, whose token names are looked up in the
+ * ``num_tokens`` strings at ``tokens``; the table must outlive the set.
+ */
+void zz_patterns_init(struct zz_patterns *set, const char *const *tokens,
+		size_t num_tokens);
+/**
+ * Destroy set of patterns
+ */
+void zz_patterns_destroy(struct zz_patterns *set);
+/**
+ * Compile ``pattern`` and add it to the set; returns its index, that starts at
+ * 0 and grows by one with every pattern, or -1 if it has a syntax error or an
+ * unknown token.
+ */
+int zz_pattern_add(struct zz_patterns *set, const char *pattern);
+/**
+ * Get the index of variable ``name`` among the bindings of the matches of
+ * ``pattern``, or -1 if the pattern has no such variable
+ */
+int zz_pattern_var(const struct zz_patterns *set, unsigned int pattern,
+		const char *name);
+/**
+ * Test ``node`` against all the patterns of the set, calling ``fn`` with
+ * ``node``, every match and ``data``; the bindings are only valid during the
+ * call. Matches are not reported in any particular order, and ``fn`` can stop
+ * the search by returning non-zero. Returns the number of matches reported.
+ */
+size_t zz_match(const struct zz_patterns *set, struct zz_node *node,
+		int (*fn)(struct zz_node *, const struct zz_match *, void *),
+		void *data);
+/**
+ * Test every node of the subtree under ``root``, in pre-order, as with
+ * zz_match(); ``fn`` must not modify the subtree, and returning non-zero
+ * stops the walk.
+ */
+size_t zz_match_tree(const struct zz_patterns *set, struct zz_node *root,
+		int (*fn)(struct zz_node *, const struct zz_match *, void *),
+		void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif          // ZEBU_PATTERN_H_
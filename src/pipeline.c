@@ -0,0 +1,110 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "pipeline.h"
+
+static void *worker(void *arg)
+{
+	struct zz_pipeline *p = arg;
+	struct zz_node *n;
+
+	pthread_mutex_lock(&p->lock);
+	for (;;) {
+		while (p->count == 0 && !p->closing)
+			pthread_cond_wait(&p->not_empty, &p->lock);
+		if (p->count == 0)
+			break;
+		n = p->queue[p->head];
+		p->head = (p->head + 1) % p->capacity;
+		--p->count;
+		pthread_cond_signal(&p->not_full);
+		pthread_mutex_unlock(&p->lock);
+
+		p->visit(n, p->data);
+
+		pthread_mutex_lock(&p->lock);
+		zz_list_append(&p->released, &n->siblings);
+	}
+	pthread_mutex_unlock(&p->lock);
+	return NULL;
+}
+
+void zz_pipeline_init(struct zz_pipeline *p, struct zz_tree *tree,
+		size_t num_workers, size_t capacity,
+		void (*visit)(struct zz_node *, void *), void *data)
+{
+	size_t i;
+
+	assert(num_workers > 0);
+	assert(capacity > 0);
+	p->tree = tree;
+	p->visit = visit;
+	p->data = data;
+	p->num_workers = num_workers;
+	p->workers = calloc(num_workers, sizeof(*p->workers));
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->not_empty, NULL);
+	pthread_cond_init(&p->not_full, NULL);
+	p->queue = calloc(capacity, sizeof(*p->queue));
+	p->capacity = capacity;
+	p->head = 0;
+	p->count = 0;
+	zz_list_init(&p->released);
+	p->closing = 0;
+	for (i = 0; i < num_workers; ++i)
+		pthread_create(&p->workers[i], NULL, worker, p);
+}
+
+void zz_pipeline_destroy(struct zz_pipeline *p)
+{
+	size_t i;
+
+	pthread_mutex_lock(&p->lock);
+	p->closing = 1;
+	pthread_cond_broadcast(&p->not_empty);
+	pthread_mutex_unlock(&p->lock);
+	for (i = 0; i < p->num_workers; ++i)
+		pthread_join(p->workers[i], NULL);
+	zz_pipeline_reclaim(p);
+	pthread_cond_destroy(&p->not_full);
+	pthread_cond_destroy(&p->not_empty);
+	pthread_mutex_destroy(&p->lock);
+	free(p->queue);
+	free(p->workers);
+}
+
+void zz_pipeline_submit(struct zz_pipeline *p, struct zz_node *node)
+{
+	zz_unlink_child(node);
+	zz_list_init(&node->siblings);
+
+	pthread_mutex_lock(&p->lock);
+	while (p->count == p->capacity)
+		pthread_cond_wait(&p->not_full, &p->lock);
+	p->queue[(p->head + p->count) % p->capacity] = node;
+	++p->count;
+	pthread_cond_signal(&p->not_empty);
+	pthread_mutex_unlock(&p->lock);
+
+	/* Reclaim after waiting, so that subtrees released meanwhile are
+	 * reused right away and the queue bounds the nodes in flight */
+	zz_pipeline_reclaim(p);
+}
+
+void zz_pipeline_reclaim(struct zz_pipeline *p)
+{
+	struct zz_list released;
+	struct zz_node *n, *x;
+
+	zz_list_init(&released);
+	pthread_mutex_lock(&p->lock);
+	if (!zz_list_empty(&p->released)) {
+		zz_list_append_list(&released, &p->released);
+		zz_list_init(&p->released);
+	}
+	pthread_mutex_unlock(&p->lock);
+
+	zz_list_foreach_entry_safe(n, x, &released, siblings) {
+		zz_list_init(&n->siblings);
+		zz_recycle(p->tree, n);
+	}
+}
@@ -0,0 +1,79 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_PIPELINE_H_
+#define ZEBU_PIPELINE_H_
+
+#include <pthread.h>
+
+#include "tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Pipeline
+ * --------
+ *
+ * Hands completed subtrees from a producer thread, usually the parser, to a
+ * pool of worker threads that process them.
+ *
+ * Ownership of a subtree is transferred with it: the producer owns it until it
+ * is submitted, a single worker owns it while visiting it, and then it is
+ * handed back to the producer, that recycles it into the tree the next time it
+ * submits a subtree. The tree itself is only ever modified by the producer, so
+ * visitors must not create, link or unlink nodes; they may create and destroy
+ * payloads, since the string dictionary is shared safely between threads.
+ */
+
+/**
+ * Pipeline from one producer to several workers
+ */
+struct zz_pipeline {
+	struct zz_tree *tree;
+	void (*visit)(struct zz_node *, void *);
+	void *data;
+	size_t num_workers;
+	pthread_t *workers;
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+	struct zz_node **queue;
+	size_t capacity;
+	size_t head;
+	size_t count;
+	struct zz_list released;
+	int closing;
+};
+
+/**
+ * Initialize pipeline and start ``num_workers`` threads, each of them calling
+ * ``visit`` on the subtrees submitted to the pipeline, with ``data`` as its
+ * second argument; up to ``capacity`` subtrees may be waiting to be visited
+ * before zz_pipeline_submit() blocks.
+ */
+void zz_pipeline_init(struct zz_pipeline *pipeline, struct zz_tree *tree,
+		size_t num_workers, size_t capacity,
+		void (*visit)(struct zz_node *, void *), void *data);
+/**
+ * Wait for all submitted subtrees to be visited, stop the workers, and recycle
+ * all subtrees into the tree.
+ */
+void zz_pipeline_destroy(struct zz_pipeline *pipeline);
+/**
+ * Submit subtree. Unlinks ``node`` from its parent and queues it to be visited
+ * by a worker, blocking if the queue is full; subtrees already visited are
+ * recycled first.
+ */
+void zz_pipeline_submit(struct zz_pipeline *pipeline, struct zz_node *node);
+/**
+ * Recycle all subtrees that have been visited since the last call; must only
+ * be called from the producer thread.
+ */
+void zz_pipeline_reclaim(struct zz_pipeline *pipeline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif          // ZEBU_PIPELINE_H_
@@ -2,30 +2,70 @@
 
 #include "print.h"
 
+#include <inttypes.h>
+
+#include "trace.h"
+
+#ifndef ZZ_COMPACT_DATA
+static void print_blob(const unsigned char *blob, size_t length, FILE *f)
+{
+	while (length > 1 && blob[length - 1] == 0)
+		--length;
+	fprintf(f, " 0x%x", length ? blob[length - 1] : 0);
+	while (length-- > 1)
+		fprintf(f, "%02x", blob[length - 1]);
+}
+#endif
+
 void zz_print(struct zz_node *node, FILE * f)
 {
 	struct zz_node *iter;
+#ifndef ZZ_COMPACT_DATA
+	const unsigned char *blob;
+	const char *slice;
+	size_t length;
+#endif
 
 	fprintf(f, "[%s", node->token);
 
-	switch (node->data.type) {
+	switch (zz_data_type(node->data)) {
 	case ZZ_NULL:
 		break;
 	case ZZ_INT:
-		fprintf(f, " %d", node->data.data.int_val);
+		fprintf(f, " %d", zz_get_int(node));
 		break;
 	case ZZ_UINT:
-		fprintf(f, " %u", node->data.data.uint_val);
+		fprintf(f, " %u", zz_get_uint(node));
 		break;
 	case ZZ_DOUBLE:
-		fprintf(f, " %f", node->data.data.double_val);
+		fprintf(f, " %f", zz_get_double(node));
 		break;
 	case ZZ_STRING:
-		fprintf(f, " \"%s\"", node->data.data.string_val);
+	case ZZ_SHORT_STRING:
+		fprintf(f, " \"%s\"", zz_get_string(node));
 		break;
 	case ZZ_POINTER:
-		fprintf(f, " %p", node->data.data.pointer_val);
+		fprintf(f, " %p", zz_get_pointer(node));
+		break;
+#ifndef ZZ_COMPACT_DATA
+	case ZZ_SLICE:
+		slice = zz_get_slice(node, &length);
+		fprintf(f, " \"%.*s\"", (int)length, slice);
 		break;
+	case ZZ_INT64:
+		fprintf(f, " %" PRId64, zz_get_int64(node));
+		break;
+	case ZZ_UINT64:
+		fprintf(f, " %" PRIu64, zz_get_uint64(node));
+		break;
+	case ZZ_BLOB:
+		blob = zz_get_blob(node, &length);
+		print_blob(blob, length, f);
+		break;
+#else
+	default:
+		break;
+#endif
 	}
 
 	zz_foreach_child(iter, node) {
@@ -36,18 +76,11 @@ void zz_print(struct zz_node *node, FILE * f)
 	fprintf(f, "]");
 }
 
-void zz_error(const char *msg, const char *file, size_t first_line,
-		size_t first_column, size_t last_line, size_t last_column)
+/* Print the lines from ``first_line`` to ``last_line`` of ``f`` with carets
+ * under the columns in the range */
+static void print_lines(FILE *f, size_t first_line, size_t first_column,
+		size_t last_line, size_t last_column)
 {
-	if (file == NULL) {
-		fprintf(stderr, "<file>:%zu: %s\n", first_line, msg);
-		return;
-	}
-	fprintf(stderr, "%s:%zu: %s", file, first_line, msg);
-	FILE *f = fopen(file, "r");
-	if (f == NULL)
-		return;
-	fseek(f, 0, SEEK_SET);
 	for (int i = 1; i < first_line; ++i) {
                 for (;;) {
                         int c = fgetc(f);
@@ -86,5 +119,44 @@ void zz_error(const char *msg, const char *file, size_t first_line,
                 fputs(buf, stderr);
         }
         free(buf);
+}
+
+void zz_error(const char *msg, const char *file, size_t first_line,
+		size_t first_column, size_t last_line, size_t last_column)
+{
+	ZZ_TRACE(ZZ_EVENT_ERROR, error, msg, first_line);
+	if (file == NULL) {
+		fprintf(stderr, "<file>:%zu: %s\n", first_line, msg);
+		return;
+	}
+	fprintf(stderr, "%s:%zu: %s", file, first_line, msg);
+	FILE *f = fopen(file, "r");
+	if (f == NULL)
+		return;
+	print_lines(f, first_line, first_column, last_line, last_column);
+	fclose(f);
+}
+
+void zz_error_span(const struct zz_sources *sources, const char *msg,
+		struct zz_span span)
+{
+	const struct zz_source *source;
+	struct zz_location first, last;
+	FILE *f;
+
+	source = zz_source_find(sources, span.begin);
+	zz_source_location(sources, span.begin, &first);
+	zz_source_location(sources, span.end > span.begin ? span.end - 1 :
+			span.begin, &last);
+	ZZ_TRACE(ZZ_EVENT_ERROR, error, msg, first.line);
+	if (source == NULL) {
+		fprintf(stderr, "<file>:%zu: %s\n", first.line, msg);
+		return;
+	}
+	fprintf(stderr, "%s:%zu: %s", first.file, first.line, msg);
+	f = fmemopen((void *)source->text, source->size, "r");
+	if (f == NULL)
+		return;
+	print_lines(f, first.line, first.column, last.line, last.column);
 	fclose(f);
 }
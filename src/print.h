@@ -27,6 +27,17 @@ void zz_print(struct zz_node *node, FILE *f);
  */
 void zz_error(const char *msg, const char *file, size_t first_line,
 		size_t first_column, size_t last_line, size_t last_column);
+/**
+ * Print error message for the text in ``span``, or in the span of ``node``,
+ * with the file, lines and columns found in ``sources``
+ */
+void zz_error_span(const struct zz_sources *sources, const char *msg,
+		struct zz_span span);
+static inline void zz_error_node(const struct zz_sources *sources,
+		const char *msg, const struct zz_node *node)
+{
+	zz_error_span(sources, msg, node->span);
+}
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,179 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "rewrite.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void zz_rewriter_init(struct zz_rewriter *rw, const char *const *tokens,
+		size_t num_tokens)
+{
+	zz_patterns_init(&rw->patterns, tokens, num_tokens);
+	rw->rules = NULL;
+	rw->num_rewrites = 0;
+}
+
+void zz_rewriter_destroy(struct zz_rewriter *rw)
+{
+	zz_patterns_destroy(&rw->patterns);
+	free(rw->rules);
+}
+
+int zz_rewrite_rule(struct zz_rewriter *rw, const char *pattern,
+		struct zz_node *(*build)(struct zz_tree *, struct zz_node *,
+			const struct zz_match *, void *), void *data)
+{
+	int index;
+
+	index = zz_pattern_add(&rw->patterns, pattern);
+	if (index < 0)
+		return -1;
+	rw->rules = realloc(rw->rules, (index + 1) * sizeof(*rw->rules));
+	rw->rules[index].build = build;
+	rw->rules[index].data = data;
+	return index;
+}
+
+/* State of a call to zz_rewrite(): the patterns that matched the node being
+ * rewritten, and their bindings, stored by pattern */
+struct rewrite {
+	struct zz_rewriter *rw;
+	struct zz_tree *tree;
+	unsigned int *matched;
+	unsigned int num_matched;
+	struct zz_node **bindings;
+	unsigned int max_vars;
+};
+
+static int collect(struct zz_node *node, const struct zz_match *match,
+		void *data)
+{
+	struct rewrite *r = data;
+	unsigned int i;
+
+	/* The matched node is the one reduce() passed to zz_match() */
+	(void)node;
+	memcpy(r->bindings + match->pattern * r->max_vars, match->bindings,
+			match->num_bindings * sizeof(*match->bindings));
+	for (i = r->num_matched; i > 0 && r->matched[i - 1] > match->pattern;
+			--i)
+		r->matched[i] = r->matched[i - 1];
+	r->matched[i] = match->pattern;
+	++r->num_matched;
+	return 0;
+}
+
+/* Apply the first rule that builds a replacement for node, and put it in the
+ * place of node; returns NULL if there is none. */
+static struct zz_node *reduce(struct rewrite *r, struct zz_node *node)
+{
+	const struct zz_rewrite_rule *rule;
+	struct zz_match match;
+	struct zz_node *ret = NULL;
+	unsigned int i;
+
+	r->num_matched = 0;
+	zz_match(&r->rw->patterns, node, collect, r);
+	for (i = 0; i < r->num_matched && ret == NULL; ++i) {
+		match.pattern = r->matched[i];
+		match.bindings = r->bindings + match.pattern * r->max_vars;
+		match.num_bindings =
+			r->rw->patterns.patterns[match.pattern].num_vars;
+		rule = &r->rw->rules[match.pattern];
+		ret = rule->build(r->tree, node, &match, rule->data);
+	}
+	if (ret == NULL)
+		return NULL;
+	++r->rw->num_rewrites;
+	if (ret != node) {
+		zz_take(ret);
+		zz_list_insert(&node->siblings, &ret->siblings);
+		zz_unlink_child(node);
+		zz_recycle(r->tree, node);
+	}
+	return ret;
+}
+
+/* Node whose children are being rewritten, and the next child to visit */
+struct frame {
+	struct zz_node *node;
+	struct zz_node *child;
+	int first;
+};
+
+/* Rewrite the subtree under root bottom-up. On the first visit every node is
+ * tried; after a rewrite, the new nodes of the replacement are tried, but not
+ * the subtrees it takes from the matched node, that are marked as normal.
+ * Returns the node that ends up in the place of root. */
+static struct zz_node *normalize(struct rewrite *r, struct zz_node *root)
+{
+	struct frame *stack, *f;
+	struct zz_node *node = root, *done, *ret;
+	size_t size = 0, alloc = 64;
+	int first = 1;
+
+	stack = malloc(alloc * sizeof(*stack));
+	for (;;) {
+		done = NULL;
+		if (!first && (node->flags & ZZ_NODE_NORMAL)) {
+			done = node;
+		} else {
+			if (size == alloc) {
+				alloc *= 2;
+				stack = realloc(stack, alloc * sizeof(*stack));
+			}
+			stack[size].node = node;
+			stack[size].child = zz_first_child(node);
+			stack[size++].first = first;
+			node->flags &= ~ZZ_NODE_NORMAL;
+		}
+		/* Climb until there is a node to enter */
+		for (;;) {
+			if (done != NULL) {
+				if (size == 0)
+					goto out;
+				f = &stack[size - 1];
+				f->child = zz_next_sibling(f->node, done);
+				done = NULL;
+			}
+			f = &stack[size - 1];
+			if (f->child != NULL) {
+				node = f->child;
+				first = f->first;
+				break;
+			}
+			--size;
+			ret = reduce(r, f->node);
+			if (ret == NULL) {
+				f->node->flags |= ZZ_NODE_NORMAL;
+				done = f->node;
+				continue;
+			}
+			node = ret;
+			first = 0;
+			break;
+		}
+	}
+out:
+	free(stack);
+	return done;
+}
+
+struct zz_node *zz_rewrite(struct zz_rewriter *rw, struct zz_tree *tree,
+		struct zz_node *root)
+{
+	struct rewrite r;
+	size_t num_patterns = rw->patterns.num_patterns;
+
+	r.rw = rw;
+	r.tree = tree;
+	r.max_vars = rw->patterns.max_vars;
+	r.matched = malloc((num_patterns + 1) * sizeof(*r.matched));
+	r.bindings = malloc((num_patterns * r.max_vars + 1) *
+			sizeof(*r.bindings));
+	r.num_matched = 0;
+	root = normalize(&r, root);
+	free(r.matched);
+	free(r.bindings);
+	return root;
+}
@@ -0,0 +1,89 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_REWRITE_H_
+#define ZEBU_REWRITE_H_
+
+#include "pattern.h"
+#include "tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Rewriting
+ * ---------
+ *
+ * A rewriter applies rules to a tree until none applies anymore. Each rule is
+ * a pattern and a function that builds the replacement of the nodes that match
+ * it; when several rules match a node, the one added first is tried first, and
+ * a function can decline a match by returning ``NULL``, so the next one is
+ * tried.
+ *
+ * A replacement is built from new nodes of the tree and from the subtrees
+ * bound to the variables of the pattern, that must be detached with zz_take()
+ * before being linked elsewhere; the function can also return a bound subtree
+ * as it is, or the matched node itself after changing it in place, with
+ * zz_set_token() and zz_set_data() so that its size, blob and index entry stay
+ * consistent; a node can't take a token with bigger nodes. Whatever is
+ * left of the matched subtree is recycled, blobs included, so new nodes must
+ * not reuse the blob payloads of nodes that are left behind.
+ *
+ * Since patterns only look at the subtree of the node they match, rules are
+ * applied bottom-up: the children of every node are rewritten before the node,
+ * and after a rewrite only the new nodes of the replacement are visited, while
+ * subtrees that were already rewritten are skipped. Rewriting a tree takes
+ * time proportional to its size plus that of the replacements, as long as the
+ * rules terminate.
+ */
+
+/**
+ * Rule of a rewriter
+ */
+struct zz_rewrite_rule {
+	struct zz_node *(*build)(struct zz_tree *, struct zz_node *,
+			const struct zz_match *, void *);
+	void *data;
+};
+
+/**
+ * Set of rules
+ */
+struct zz_rewriter {
+	struct zz_patterns patterns;
+	struct zz_rewrite_rule *rules;
+	size_t num_rewrites;
+};
+
+/**
+ * Initialize a rewriter without rules; token names in patterns are looked up
+ * in the ``num_tokens`` strings at ``tokens``, as with zz_patterns_init().
+ */
+void zz_rewriter_init(struct zz_rewriter *rw, const char *const *tokens,
+		size_t num_tokens);
+/**
+ * Destroy rewriter
+ */
+void zz_rewriter_destroy(struct zz_rewriter *rw);
+/**
+ * Add a rule that replaces the nodes that match ``pattern`` with what
+ * ``build`` returns, called with the tree, the matched node, the match and
+ * ``data``; returns the index of the pattern, or -1 if it is not valid.
+ */
+int zz_rewrite_rule(struct zz_rewriter *rw, const char *pattern,
+		struct zz_node *(*build)(struct zz_tree *, struct zz_node *,
+			const struct zz_match *, void *), void *data);
+/**
+ * Apply the rules to the subtree under ``root``, that belongs to ``tree``,
+ * until none applies; returns the new root, that takes the place of the old
+ * one under its parent, if any. The number of rewrites is added to
+ * ``rw->num_rewrites``.
+ */
+struct zz_node *zz_rewrite(struct zz_rewriter *rw, struct zz_tree *tree,
+		struct zz_node *root);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif          // ZEBU_REWRITE_H_
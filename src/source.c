@@ -0,0 +1,151 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "source.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void zz_sources_init(struct zz_sources *sources)
+{
+	sources->files = NULL;
+	sources->num_files = 0;
+	sources->alloc = 0;
+	sources->next_base = 1;
+}
+
+void zz_sources_destroy(struct zz_sources *sources)
+{
+	size_t i;
+
+	for (i = 0; i < sources->num_files; ++i) {
+		free(sources->files[i].name);
+		free(sources->files[i].lines);
+		if (sources->files[i].owns_text)
+			free((char *)sources->files[i].text);
+	}
+	free(sources->files);
+}
+
+static void index_lines(struct zz_source *s)
+{
+	const char *p = s->text, *end = s->text + s->size;
+	size_t alloc = 64;
+
+	s->lines = malloc(alloc * sizeof(*s->lines));
+	s->lines[0] = 0;
+	s->num_lines = 1;
+	while ((p = memchr(p, '\n', end - p)) != NULL) {
+		if (s->num_lines == alloc) {
+			alloc *= 2;
+			s->lines = realloc(s->lines, alloc * sizeof(*s->lines));
+		}
+		s->lines[s->num_lines++] = ++p - s->text;
+	}
+}
+
+uint32_t zz_source_add(struct zz_sources *sources, const char *name,
+		const char *text, size_t size)
+{
+	struct zz_source *s;
+
+	/* Leave room for the offset one past the end */
+	if (size >= UINT32_MAX - sources->next_base)
+		return 0;
+	if (sources->num_files == sources->alloc) {
+		sources->alloc = sources->alloc ? sources->alloc * 2 : 8;
+		sources->files = realloc(sources->files,
+				sources->alloc * sizeof(*sources->files));
+	}
+	s = &sources->files[sources->num_files++];
+	s->name = strdup(name);
+	s->text = text;
+	s->size = size;
+	s->base = sources->next_base;
+	s->owns_text = 0;
+	index_lines(s);
+	sources->next_base += size + 1;
+	return s->base;
+}
+
+uint32_t zz_source_add_file(struct zz_sources *sources, const char *name)
+{
+	FILE *f;
+	char *text;
+	long size;
+	uint32_t base;
+
+	f = fopen(name, "r");
+	if (f == NULL)
+		return 0;
+	if (fseek(f, 0, SEEK_END) < 0 || (size = ftell(f)) < 0 ||
+			fseek(f, 0, SEEK_SET) < 0) {
+		fclose(f);
+		return 0;
+	}
+	text = malloc(size + 1);
+	if (fread(text, 1, size, f) != (size_t)size) {
+		free(text);
+		fclose(f);
+		return 0;
+	}
+	fclose(f);
+	base = zz_source_add(sources, name, text, size);
+	if (base == 0)
+		free(text);
+	else
+		sources->files[sources->num_files - 1].owns_text = 1;
+	return base;
+}
+
+const struct zz_source *zz_source_find(const struct zz_sources *sources,
+		uint32_t offset)
+{
+	size_t lo = 0, hi = sources->num_files, mid;
+	const struct zz_source *s;
+
+	/* Last file whose base is not above offset */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (sources->files[mid].base <= offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0)
+		return NULL;
+	s = &sources->files[lo - 1];
+	if (offset - s->base > s->size)
+		return NULL;
+	return s;
+}
+
+int zz_source_location(const struct zz_sources *sources, uint32_t offset,
+		struct zz_location *location)
+{
+	const struct zz_source *s;
+	size_t lo, hi, mid;
+	uint32_t pos;
+
+	s = zz_source_find(sources, offset);
+	if (s == NULL) {
+		location->file = NULL;
+		location->line = 0;
+		location->column = 0;
+		return 0;
+	}
+	pos = offset - s->base;
+	lo = 0;
+	hi = s->num_lines;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (s->lines[mid] <= pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	location->file = s->name;
+	location->line = lo;
+	location->column = pos - s->lines[lo - 1] + 1;
+	return 1;
+}
@@ -0,0 +1,122 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_SOURCE_H_
+#define ZEBU_SOURCE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Sources
+ * -------
+ *
+ * Every node has a span, the range of source text it was parsed from, stored
+ * as two 32-bit offsets. Offsets are positions in a single space shared by all
+ * the files registered in a zz_sources object, each of them taking the range
+ * right after the previous one, so the offset alone tells both the file and
+ * the byte in it; offset 0 belongs to no file, and is the span of nodes with
+ * no known location. Offsets are turned into file, line and column with a
+ * binary search on the files, and then on the lines of the file.
+ */
+
+/**
+ * Range of offsets ``[begin, end)``
+ */
+struct zz_span {
+	uint32_t begin;
+	uint32_t end;
+};
+
+/**
+ * A source file, the offset of its first byte, and the offset in the file of
+ * the start of every line
+ */
+struct zz_source {
+	char *name;
+	const char *text;
+	size_t size;
+	uint32_t base;
+	uint32_t *lines;
+	size_t num_lines;
+	int owns_text;
+};
+
+/**
+ * Set of source files
+ */
+struct zz_sources {
+	struct zz_source *files;
+	size_t num_files;
+	size_t alloc;
+	uint32_t next_base;
+};
+
+/**
+ * File, line and column of an offset; lines and columns start at 1, and
+ * columns count bytes
+ */
+struct zz_location {
+	const char *file;
+	size_t line;
+	size_t column;
+};
+
+/**
+ * Create a span
+ */
+static inline struct zz_span zz_span(uint32_t begin, uint32_t end)
+{
+	return (struct zz_span){ begin, end };
+}
+/**
+ * Get the smallest span that covers ``a`` and ``b``, ignoring unknown spans;
+ * this is the span of a node built from the nodes of ``a`` and ``b``.
+ */
+static inline struct zz_span zz_span_join(struct zz_span a, struct zz_span b)
+{
+	if (a.begin == 0)
+		return b;
+	if (b.begin == 0)
+		return a;
+	return (struct zz_span){ a.begin < b.begin ? a.begin : b.begin,
+		a.end > b.end ? a.end : b.end };
+}
+/**
+ * Initialize and destroy a set of sources
+ */
+void zz_sources_init(struct zz_sources *sources);
+void zz_sources_destroy(struct zz_sources *sources);
+/**
+ * Add the ``size`` bytes of ``text`` as the contents of file ``name``, and
+ * return the offset of its first byte; ``text`` is not copied, and must
+ * outlive the set. Returns 0 if the offsets would overflow.
+ */
+uint32_t zz_source_add(struct zz_sources *sources, const char *name,
+		const char *text, size_t size);
+/**
+ * Read file ``name`` and add its contents; returns 0 if it can't be read.
+ */
+uint32_t zz_source_add_file(struct zz_sources *sources, const char *name);
+/**
+ * Find the source that contains ``offset``, or ``NULL`` if there is none; the
+ * offset one past the end of a source belongs to it, so that empty spans at
+ * the end of a file can be located.
+ */
+const struct zz_source *zz_source_find(const struct zz_sources *sources,
+		uint32_t offset);
+/**
+ * Get file, line and column of ``offset``; returns 0, and sets ``file`` to
+ * ``NULL``, if the offset belongs to no file.
+ */
+int zz_source_location(const struct zz_sources *sources, uint32_t offset,
+		struct zz_location *location);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif          // ZEBU_SOURCE_H_
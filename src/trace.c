@@ -0,0 +1,35 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+struct zz_trace_hook *zz_trace_hook = NULL;
+
+/* Every hook installed so far, one per distinct function and data; they are
+ * never freed, since other threads may still be calling the one replaced */
+static struct zz_trace_hook *hooks = NULL;
+static pthread_mutex_t hooks_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void zz_set_trace_hook(void (*hook)(enum zz_event, const void *, size_t, void *),
+		void *data)
+{
+	struct zz_trace_hook *h = NULL;
+
+	if (hook != NULL) {
+		pthread_mutex_lock(&hooks_lock);
+		for (h = hooks; h != NULL; h = h->next)
+			if (h->fn == hook && h->data == data)
+				break;
+		if (h == NULL) {
+			h = malloc(sizeof(*h));
+			h->fn = hook;
+			h->data = data;
+			h->next = hooks;
+			hooks = h;
+		}
+		pthread_mutex_unlock(&hooks_lock);
+	}
+	__atomic_store_n(&zz_trace_hook, h, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,108 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_TRACE_H_
+#define ZEBU_TRACE_H_
+
+#include <stddef.h>
+
+#ifdef ZZ_USDT
+#include <sys/sdt.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Trace
+ * -----
+ *
+ * Events fired on allocation, string interning, teardown and error reporting.
+ *
+ * If the library is built with ``-DZZ_USDT``, every event is also a USDT
+ * probe in the ``zebu`` provider, that can be attached to with perf or
+ * bpftrace; otherwise, probes are compiled out. Independently of that, a hook
+ * can be installed at run time to receive every event; when there is none,
+ * each event costs a single branch.
+ *
+ * Every event carries a pointer and a number:
+ *
+ *    +--------------------------+------------+-------------------------+
+ *    | Event                    | Pointer    | Number                  |
+ *    +==========================+============+=========================+
+ *    | ``ZZ_EVENT_NODE``        | node       | node size               |
+ *    +--------------------------+------------+-------------------------+
+ *    | ``ZZ_EVENT_STRING_HIT``  | string     | length                  |
+ *    +--------------------------+------------+-------------------------+
+ *    | ``ZZ_EVENT_STRING_MISS`` | string     | length                  |
+ *    +--------------------------+------------+-------------------------+
+ *    | ``ZZ_EVENT_STRING_DEL``  | string     | length                  |
+ *    +--------------------------+------------+-------------------------+
+ *    | ``ZZ_EVENT_DESTROY``     | tree       | live nodes              |
+ *    +--------------------------+------------+-------------------------+
+ *    | ``ZZ_EVENT_DESTROYED``   | tree       | live nodes              |
+ *    +--------------------------+------------+-------------------------+
+ *    | ``ZZ_EVENT_ERROR``       | message    | first line              |
+ *    +--------------------------+------------+-------------------------+
+ */
+
+/**
+ * Trace events
+ */
+enum zz_event {
+	ZZ_EVENT_NODE,
+	ZZ_EVENT_STRING_HIT,
+	ZZ_EVENT_STRING_MISS,
+	ZZ_EVENT_STRING_DEL,
+	ZZ_EVENT_DESTROY,
+	ZZ_EVENT_DESTROYED,
+	ZZ_EVENT_ERROR
+};
+
+/**
+ * Install ``hook`` to be called on every event, with ``data`` as its last
+ * argument; pass ``NULL`` to remove it. The hook may be called from any
+ * thread that uses the library, and events fired while it is replaced reach
+ * either the old hook or the new one, always with its own ``data``.
+ */
+void zz_set_trace_hook(void (*hook)(enum zz_event, const void *, size_t, void *),
+		void *data);
+
+/**
+ * Hook and the data it is called with, published together
+ */
+struct zz_trace_hook {
+	void (*fn)(enum zz_event, const void *, size_t, void *);
+	void *data;
+	struct zz_trace_hook *next;
+};
+
+/**
+ * Current hook, or ``NULL``; use zz_set_trace_hook() to change it
+ */
+extern struct zz_trace_hook *zz_trace_hook;
+
+/**
+ * Fire an event; ``probe`` is the name of the USDT probe
+ */
+#ifdef ZZ_USDT
+#define ZZ_TRACING() 1
+#define ZZ_PROBE(probe, ptr, value) DTRACE_PROBE2(zebu, probe, ptr, value)
+#else
+#define ZZ_TRACING() (__atomic_load_n(&zz_trace_hook, __ATOMIC_RELAXED) != NULL)
+#define ZZ_PROBE(probe, ptr, value) do { } while (0)
+#endif
+#define ZZ_TRACE(event, probe, ptr, value) \
+do { \
+	const struct zz_trace_hook *zz_hook_; \
+	ZZ_PROBE(probe, ptr, value); \
+	zz_hook_ = __atomic_load_n(&zz_trace_hook, __ATOMIC_ACQUIRE); \
+	if (__builtin_expect(zz_hook_ != NULL, 0)) \
+		zz_hook_->fn(event, ptr, value, zz_hook_->data); \
+} while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif          // ZEBU_TRACE_H_
@@ -6,37 +6,624 @@
 #include <stdarg.h>
 #include <string.h>
 
+#include "trace.h"
+
+static unsigned long next_tree_id = 0;
+
+struct zz_list zz_no_children = { &zz_no_children, &zz_no_children };
+
+/* Cache used by this thread the last time it created a node in a concurrent
+ * tree; tree ids are never reused, so an entry that belongs to a destroyed
+ * tree can't be mistaken for one of a new tree at the same address. */
+static __thread struct {
+	struct zz_tree *tree;
+	unsigned long id;
+	struct zz_tree_cache *cache;
+} last_cache;
+
 void zz_tree_init(struct zz_tree *tree, size_t node_size)
 {
 	assert(node_size >= sizeof(struct zz_node));
 	tree->node_size = node_size;
 	zz_list_init(&tree->nodes);
+	zz_list_init(&tree->recycled);
+	zz_list_init(&tree->recycled_leaves);
+	tree->consumer = NULL;
+	tree->consumer_data = NULL;
+	tree->id = __atomic_add_fetch(&next_tree_id, 1, __ATOMIC_RELAXED);
+	tree->concurrent = 0;
+	tree->caches = NULL;
+	tree->num_nodes = 0;
+	tree->num_recycled = 0;
+	tree->allocator = NULL;
+	zz_arena_init(&tree->arena, NULL);
+	pthread_mutex_init(&tree->arena_lock, NULL);
+	memset(tree->free_blobs, 0, sizeof(tree->free_blobs));
+	tree->token_sizes = NULL;
+	tree->num_token_sizes = 0;
+	tree->token_sizes_alloc = 0;
+	tree->pools = NULL;
+	tree->num_pools = 0;
+	tree->bytes_used = 0;
+	tree->bytes_recycled = 0;
+	tree->next_node_id = 0;
+	tree->indexed = 0;
+	tree->index = NULL;
+	tree->num_indexed = 0;
+	tree->index_alloc = 0;
+	/* Set up with the allocator of the tree when indexing starts */
+	zz_column_init(&tree->index_slots, 0, NULL);
+}
+
+static inline size_t hash_token(const char *token, size_t alloc)
+{
+	return ((size_t)token >> 3) & (alloc - 1);
+}
+
+/* Pool of the nodes of token, or NULL if they have the default size */
+static inline struct zz_tree_pool *find_pool(const struct zz_tree *tree,
+		const char *token)
+{
+	struct zz_token_size *e;
+	size_t i;
+
+	if (tree->token_sizes == NULL)
+		return NULL;
+	i = hash_token(token, tree->token_sizes_alloc);
+	for (;;) {
+		e = &tree->token_sizes[i];
+		if (e->token == token)
+			return e->pool;
+		if (e->token == NULL)
+			return NULL;
+		i = (i + 1) & (tree->token_sizes_alloc - 1);
+	}
+}
+
+/* Pool the node was created in, which its token may no longer map to */
+static inline struct zz_tree_pool *node_pool(const struct zz_tree *tree,
+		const struct zz_node *node)
+{
+	unsigned int number = node->flags >> ZZ_NODE_POOL_SHIFT;
+
+	return number != 0 ? tree->pools[number - 1] : NULL;
+}
+
+static inline size_t pool_size(const struct zz_tree *tree,
+		const struct zz_tree_pool *pool)
+{
+	return pool != NULL ? pool->size : tree->node_size;
+}
+
+size_t zz_tree_node_size(const struct zz_tree *tree, const char *token)
+{
+	return pool_size(tree, find_pool(tree, token));
+}
+
+size_t zz_tree_sizeof(const struct zz_tree *tree, const struct zz_node *node)
+{
+	if (zz_is_leaf(node))
+		return ZZ_LEAF_SIZE;
+	return pool_size(tree, node_pool(tree, node));
+}
+
+unsigned int zz_tree_num_ids(const struct zz_tree *tree)
+{
+	return __atomic_load_n(&tree->next_node_id, __ATOMIC_RELAXED);
+}
+
+/* Entry of the index for token, or the empty one where it would go */
+static inline struct zz_token_index *find_index(struct zz_token_index *table,
+		size_t alloc, const char *token)
+{
+	size_t i = hash_token(token, alloc);
+
+	while (table[i].token != NULL && table[i].token != token)
+		i = (i + 1) & (alloc - 1);
+	return &table[i];
+}
+
+/* Where a node is in the index: the token it was indexed with, that it may no
+ * longer have, and its position in the array of that token */
+struct index_slot {
+	const char *token;
+	unsigned int slot;
+};
+
+static void index_add(struct zz_tree *tree, struct zz_node *node)
+{
+	struct zz_token_index *e, *old;
+	struct index_slot *slot;
+	size_t i, old_alloc;
+
+	if ((tree->num_indexed + 1) * 2 > tree->index_alloc) {
+		old = tree->index;
+		old_alloc = tree->index_alloc;
+		tree->index_alloc = old_alloc ? old_alloc * 2 : 16;
+		tree->index = zz_calloc(tree->allocator,
+				tree->index_alloc * sizeof(*tree->index));
+		for (i = 0; i < old_alloc; ++i)
+			if (old[i].token != NULL)
+				*find_index(tree->index, tree->index_alloc,
+						old[i].token) = old[i];
+		if (old != NULL)
+			zz_free(tree->allocator, old,
+					old_alloc * sizeof(*old));
+	}
+	e = find_index(tree->index, tree->index_alloc, node->token);
+	if (e->token == NULL) {
+		e->token = node->token;
+		++tree->num_indexed;
+	}
+	if (e->size == e->alloc) {
+		e->alloc = e->alloc ? e->alloc * 2 : 16;
+		if (e->nodes == NULL)
+			e->nodes = zz_alloc(tree->allocator,
+					e->alloc * sizeof(*e->nodes));
+		else
+			e->nodes = zz_realloc(tree->allocator, e->nodes,
+					e->size * sizeof(*e->nodes),
+					e->alloc * sizeof(*e->nodes));
+	}
+	slot = zz_column_at(&tree->index_slots, node);
+	slot->token = node->token;
+	slot->slot = e->size;
+	e->nodes[e->size++] = node;
+	node->flags |= ZZ_NODE_INDEXED;
+}
+
+static void index_remove(struct zz_tree *tree, struct zz_node *node)
+{
+	struct zz_token_index *e;
+	struct index_slot *slot;
+	struct zz_node *last;
+
+	/* Nodes still in the cache of a concurrent tree are not indexed */
+	if (!(node->flags & ZZ_NODE_INDEXED))
+		return;
+	slot = zz_column_at(&tree->index_slots, node);
+	e = find_index(tree->index, tree->index_alloc, slot->token);
+	assert(slot->slot < e->size && e->nodes[slot->slot] == node);
+	last = e->nodes[--e->size];
+	e->nodes[slot->slot] = last;
+	((struct index_slot *)zz_column_at(&tree->index_slots, last))->slot =
+		slot->slot;
+	node->flags &= ~ZZ_NODE_INDEXED;
+}
+
+static void index_free(struct zz_tree *tree)
+{
+	struct zz_token_index *e;
+	size_t i;
+
+	for (i = 0; i < tree->index_alloc; ++i) {
+		e = &tree->index[i];
+		if (e->nodes != NULL)
+			zz_free(tree->allocator, e->nodes,
+					e->alloc * sizeof(*e->nodes));
+	}
+	if (tree->index != NULL)
+		zz_free(tree->allocator, tree->index,
+				tree->index_alloc * sizeof(*tree->index));
+	tree->index = NULL;
+	tree->num_indexed = 0;
+	tree->index_alloc = 0;
+	zz_column_destroy(&tree->index_slots);
+}
+
+void zz_tree_set_indexed(struct zz_tree *tree, int indexed)
+{
+	struct zz_node *n;
+
+	if (!indexed) {
+		zz_list_foreach_entry(n, &tree->nodes, allocated)
+			n->flags &= ~ZZ_NODE_INDEXED;
+		index_free(tree);
+	} else if (!tree->indexed) {
+		zz_tree_sync(tree);
+		zz_column_init(&tree->index_slots, sizeof(struct index_slot),
+				tree->allocator);
+		zz_column_reserve(&tree->index_slots, zz_tree_num_ids(tree));
+		zz_list_foreach_entry(n, &tree->nodes, allocated)
+			index_add(tree, n);
+	}
+	tree->indexed = indexed;
+}
+
+struct zz_node **zz_tree_token_nodes(struct zz_tree *tree, const char *token,
+		size_t *count)
+{
+	struct zz_token_index *e;
+
+	assert(tree->indexed);
+	if (tree->index == NULL) {
+		*count = 0;
+		return NULL;
+	}
+	e = find_index(tree->index, tree->index_alloc, token);
+	*count = e->size;
+	return e->nodes;
+}
+
+static void insert_token_size(struct zz_token_size *table, size_t alloc,
+		const char *token, struct zz_tree_pool *pool)
+{
+	size_t i = hash_token(token, alloc);
+
+	while (table[i].token != NULL && table[i].token != token)
+		i = (i + 1) & (alloc - 1);
+	table[i].token = token;
+	table[i].pool = pool;
+}
+
+void zz_tree_set_token_size(struct zz_tree *tree, const char *token,
+		size_t size)
+{
+	struct zz_token_size *old;
+	struct zz_tree_pool *pool;
+	size_t i, old_alloc;
+
+	assert(size >= sizeof(struct zz_node));
+	assert(tree->num_nodes == 0 && tree->num_recycled == 0);
+	assert(tree->caches == NULL);
+	pool = NULL;
+	for (i = 0; i < tree->num_pools; ++i)
+		if (tree->pools[i]->size == size)
+			pool = tree->pools[i];
+	if (pool == NULL) {
+		assert(tree->num_pools + 1 < 1U << (32 - ZZ_NODE_POOL_SHIFT));
+		pool = zz_alloc(tree->allocator, sizeof(*pool));
+		pool->number = tree->num_pools + 1;
+		pool->size = size;
+		zz_list_init(&pool->recycled);
+		if (tree->pools == NULL)
+			tree->pools = zz_alloc(tree->allocator,
+					sizeof(*tree->pools));
+		else
+			tree->pools = zz_realloc(tree->allocator, tree->pools,
+					tree->num_pools * sizeof(*tree->pools),
+					(tree->num_pools + 1) *
+					sizeof(*tree->pools));
+		tree->pools[tree->num_pools++] = pool;
+	}
+	if ((tree->num_token_sizes + 1) * 2 > tree->token_sizes_alloc) {
+		old = tree->token_sizes;
+		old_alloc = tree->token_sizes_alloc;
+		tree->token_sizes_alloc = old_alloc ? old_alloc * 2 : 16;
+		tree->token_sizes = zz_calloc(tree->allocator,
+				tree->token_sizes_alloc *
+				sizeof(*tree->token_sizes));
+		for (i = 0; i < old_alloc; ++i)
+			if (old[i].token != NULL)
+				insert_token_size(tree->token_sizes,
+						tree->token_sizes_alloc,
+						old[i].token, old[i].pool);
+		if (old != NULL)
+			zz_free(tree->allocator, old,
+					old_alloc * sizeof(*old));
+	}
+	if (find_pool(tree, token) == NULL)
+		++tree->num_token_sizes;
+	insert_token_size(tree->token_sizes, tree->token_sizes_alloc, token,
+			pool);
 }
 
 void zz_tree_destroy(struct zz_tree * tree)
 {
 	struct zz_node *n, *x;
+
+	zz_tree_sync(tree);
+	ZZ_TRACE(ZZ_EVENT_DESTROY, tree_destroy, tree, tree->num_nodes);
 	zz_list_foreach_entry_safe(n, x, &tree->nodes, allocated) {
 		zz_data_destroy(n->data);
-		free(n);
+		zz_free(tree->allocator, n, zz_tree_sizeof(tree, n));
 	}
+	zz_tree_release(tree);
+	ZZ_TRACE(ZZ_EVENT_DESTROYED, tree_destroyed, tree, tree->num_nodes);
 }
 
-struct zz_node *zz_node(struct zz_tree * tree, const char *token, struct zz_data data)
+void zz_tree_release(struct zz_tree *tree)
+{
+	struct zz_tree_pool *pool;
+	struct zz_node *n, *x;
+	size_t i;
+
+	zz_list_foreach_entry_safe(n, x, &tree->recycled, allocated)
+		zz_free(tree->allocator, n, tree->node_size);
+	zz_list_foreach_entry_safe(n, x, &tree->recycled_leaves, allocated)
+		zz_free(tree->allocator, n, ZZ_LEAF_SIZE);
+	for (i = 0; i < tree->num_pools; ++i) {
+		pool = tree->pools[i];
+		zz_list_foreach_entry_safe(n, x, &pool->recycled, allocated)
+			zz_free(tree->allocator, n, pool->size);
+		zz_free(tree->allocator, pool, sizeof(*pool));
+	}
+	if (tree->pools != NULL)
+		zz_free(tree->allocator, tree->pools,
+				tree->num_pools * sizeof(*tree->pools));
+	if (tree->token_sizes != NULL)
+		zz_free(tree->allocator, tree->token_sizes,
+				tree->token_sizes_alloc *
+				sizeof(*tree->token_sizes));
+	index_free(tree);
+	zz_arena_destroy(&tree->arena);
+	memset(tree->free_blobs, 0, sizeof(tree->free_blobs));
+	pthread_mutex_destroy(&tree->arena_lock);
+}
+
+void zz_tree_set_allocator(struct zz_tree *tree,
+		const struct zz_allocator *allocator)
 {
-	struct zz_node *n = calloc(1, tree->node_size);
-	zz_list_init(&n->children);
+	assert(tree->num_nodes == 0 && tree->num_recycled == 0);
+	assert(tree->arena.chunks == NULL);
+	assert(tree->pools == NULL && tree->token_sizes == NULL);
+	tree->allocator = allocator;
+	tree->index_slots.allocator = allocator;
+	tree->arena.allocator = allocator;
+}
+
+void zz_tree_set_concurrent(struct zz_tree *tree, int concurrent)
+{
+	tree->concurrent = concurrent;
+}
+
+void zz_tree_sync(struct zz_tree *tree)
+{
+	struct zz_tree_cache *cache, *next;
+	struct zz_node *n;
+
+	cache = __atomic_exchange_n(&tree->caches, NULL, __ATOMIC_ACQUIRE);
+	for (; cache != NULL; cache = next) {
+		next = cache->next;
+		if (tree->indexed)
+			zz_list_foreach_entry(n, &cache->nodes, allocated)
+				index_add(tree, n);
+		if (!zz_list_empty(&cache->nodes))
+			zz_list_append_list(&tree->nodes, &cache->nodes);
+		tree->num_nodes += cache->num_nodes;
+		tree->bytes_used += cache->bytes_used;
+		zz_free(tree->allocator, cache, sizeof(*cache));
+	}
+	/* Caches are gone, so every thread will register a new one */
+	tree->id = __atomic_add_fetch(&next_tree_id, 1, __ATOMIC_RELAXED);
+}
+
+void zz_tree_merge(struct zz_tree *tree, struct zz_tree *src)
+{
+	struct zz_node *n;
+	void **last;
+	int i;
+
+	if (tree->indexed)
+		zz_list_foreach_entry(n, &src->nodes, allocated)
+			index_add(tree, n);
+	if (!zz_list_empty(&src->nodes)) {
+		zz_list_append_list(&tree->nodes, &src->nodes);
+		zz_list_init(&src->nodes);
+	}
+	tree->num_nodes += src->num_nodes;
+	tree->bytes_used += src->bytes_used;
+	src->num_nodes = 0;
+	src->bytes_used = 0;
+	zz_arena_merge(&tree->arena, &src->arena);
+	for (i = 0; i < ZZ_BLOB_CLASSES; ++i) {
+		for (last = &tree->free_blobs[i]; *last != NULL; last = *last)
+			;
+		*last = src->free_blobs[i];
+		src->free_blobs[i] = NULL;
+	}
+}
+
+static struct zz_tree_cache *get_cache(struct zz_tree *tree)
+{
+	struct zz_tree_cache *cache;
+	pthread_t self;
+
+	if (last_cache.tree == tree && last_cache.id == tree->id)
+		return last_cache.cache;
+	self = pthread_self();
+	cache = __atomic_load_n(&tree->caches, __ATOMIC_ACQUIRE);
+	for (; cache != NULL; cache = cache->next)
+		if (pthread_equal(cache->owner, self))
+			break;
+	if (cache == NULL) {
+		cache = zz_calloc(tree->allocator, sizeof(*cache));
+		cache->owner = self;
+		zz_list_init(&cache->nodes);
+		cache->next = __atomic_load_n(&tree->caches, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(&tree->caches, &cache->next,
+					cache, 1, __ATOMIC_RELEASE,
+					__ATOMIC_RELAXED))
+			continue;
+	}
+	last_cache.tree = tree;
+	last_cache.id = tree->id;
+	last_cache.cache = cache;
+	return cache;
+}
+
+static struct zz_node *new_node(struct zz_tree *tree, const char *token,
+		struct zz_data data, size_t size, struct zz_list *recycled,
+		unsigned int flags)
+{
+	struct zz_tree_cache *cache;
+	struct zz_node *n;
+	unsigned int id;
+
+	if (tree->concurrent) {
+		n = zz_calloc(tree->allocator, size);
+		n->id = __atomic_fetch_add(&tree->next_node_id, 1,
+				__ATOMIC_RELAXED);
+		cache = get_cache(tree);
+		zz_list_append(&cache->nodes, &n->allocated);
+		__atomic_store_n(&cache->num_nodes, cache->num_nodes + 1,
+				__ATOMIC_RELAXED);
+		__atomic_store_n(&cache->bytes_used, cache->bytes_used + size,
+				__ATOMIC_RELAXED);
+	} else {
+		++tree->num_nodes;
+		tree->bytes_used += size;
+		if (!zz_list_empty(recycled)) {
+			n = zz_list_first_entry(recycled, struct zz_node,
+					allocated);
+			zz_list_unlink(&n->allocated);
+			id = n->id;
+			memset(n, 0, size);
+			n->id = id;
+			--tree->num_recycled;
+			tree->bytes_recycled -= size;
+		} else {
+			n = zz_calloc(tree->allocator, size);
+			n->id = tree->next_node_id++;
+		}
+		zz_list_init(&n->allocated);
+		zz_list_append(&tree->nodes, &n->allocated);
+	}
 	zz_list_init(&n->siblings);
-	zz_list_init(&n->allocated);
+	if (!(flags & ZZ_NODE_LEAF))
+		zz_list_init(&n->children);
+	n->flags = flags;
 	n->token = token;
-	zz_list_append(&tree->nodes, &n->allocated);
 	n->data = data;
+	if (tree->indexed && !tree->concurrent)
+		index_add(tree, n);
+	ZZ_TRACE(ZZ_EVENT_NODE, node, n, size);
 	return n;
 }
 
+struct zz_node *zz_node(struct zz_tree * tree, const char *token, struct zz_data data)
+{
+	struct zz_tree_pool *pool;
+
+	pool = find_pool(tree, token);
+	if (pool == NULL)
+		return new_node(tree, token, data, tree->node_size,
+				&tree->recycled, 0);
+	return new_node(tree, token, data, pool->size, &pool->recycled,
+			pool->number << ZZ_NODE_POOL_SHIFT);
+}
+
+struct zz_node *zz_leaf(struct zz_tree *tree, const char *token,
+		struct zz_data data)
+{
+	return new_node(tree, token, data, ZZ_LEAF_SIZE, &tree->recycled_leaves,
+			ZZ_NODE_LEAF);
+}
+
+void *zz_tree_alloc(struct zz_tree *tree, size_t size, size_t align)
+{
+	void *ptr;
+
+	if (!tree->concurrent)
+		return zz_arena_alloc(&tree->arena, size, align);
+	pthread_mutex_lock(&tree->arena_lock);
+	ptr = zz_arena_alloc(&tree->arena, size, align);
+	pthread_mutex_unlock(&tree->arena_lock);
+	return ptr;
+}
+
+#ifndef ZZ_COMPACT_DATA
+/* Smallest size class that fits length bytes; blocks are at least 16 bytes,
+ * so a recycled one can hold the link to the next free block */
+static unsigned int blob_class(size_t length)
+{
+	unsigned int ret = 0;
+
+	while ((size_t)16 << ret < length)
+		++ret;
+	return ret;
+}
+
+struct zz_data zz_blob(struct zz_tree *tree, const void *data, size_t length)
+{
+	unsigned int class;
+	void **blob;
+
+	assert(length <= (unsigned int)-1);
+	class = blob_class(length);
+	if (tree->concurrent)
+		pthread_mutex_lock(&tree->arena_lock);
+	blob = tree->free_blobs[class];
+	if (blob != NULL)
+		tree->free_blobs[class] = *blob;
+	else
+		blob = zz_arena_alloc(&tree->arena, (size_t)16 << class,
+				sizeof(void *));
+	if (tree->concurrent)
+		pthread_mutex_unlock(&tree->arena_lock);
+	memcpy(blob, data, length);
+	return (struct zz_data){ .type = ZZ_BLOB, .length = length,
+		.data.blob_val = (const unsigned char *)blob };
+}
+
+/* Put the storage of a blob in the free list of its size class */
+static void free_blob(struct zz_tree *tree, struct zz_data data)
+{
+	unsigned int class;
+	size_t length;
+	void **blob;
+
+	blob = (void **)zz_to_blob(data, &length);
+	class = blob_class(length);
+	if (tree->concurrent)
+		pthread_mutex_lock(&tree->arena_lock);
+	*blob = tree->free_blobs[class];
+	tree->free_blobs[class] = blob;
+	if (tree->concurrent)
+		pthread_mutex_unlock(&tree->arena_lock);
+}
+#endif
+
+void zz_set_data(struct zz_tree *tree, struct zz_node *node,
+		struct zz_data data)
+{
+#ifndef ZZ_COMPACT_DATA
+	if (zz_is_blob(node))
+		free_blob(tree, node->data);
+#endif
+	zz_data_destroy(node->data);
+	node->data = data;
+}
+
+int zz_set_token(struct zz_tree *tree, struct zz_node *node,
+		const char *token)
+{
+	int indexed = node->flags & ZZ_NODE_INDEXED;
+
+	if (!zz_is_leaf(node) &&
+			zz_tree_sizeof(tree, node) < zz_tree_node_size(tree, token))
+		return -1;
+	if (indexed)
+		index_remove(tree, node);
+	node->token = token;
+	if (indexed)
+		index_add(tree, node);
+	return 0;
+}
+
 struct zz_node *zz_copy(struct zz_tree *tree, struct zz_node *node)
 {
-	return zz_node(tree, node->token, zz_data_copy(node->data));
+	struct zz_node *ret;
+	struct zz_data data;
+#ifndef ZZ_COMPACT_DATA
+	const unsigned char *blob;
+	size_t length;
+
+	if (zz_is_blob(node)) {
+		blob = zz_get_blob(node, &length);
+		data = zz_blob(tree, blob, length);
+	} else {
+		data = zz_data_copy(node->data);
+	}
+#else
+	data = zz_data_copy(node->data);
+#endif
+	if (zz_is_leaf(node))
+		ret = zz_leaf(tree, node->token, data);
+	else
+		ret = zz_node(tree, node->token, data);
+	ret->span = node->span;
+	return ret;
 }
 
 struct zz_node * zz_copy_recursive(struct zz_tree * tree, struct zz_node * node)
@@ -47,8 +634,135 @@ struct zz_node * zz_copy_recursive(struct zz_tree * tree, struct zz_node * node)
 	ret = zz_copy(tree, node);
 	if (ret == NULL)
 		return ret;
-	zz_list_foreach_entry(iter, &node->children, siblings)
+	zz_foreach_child(iter, node)
 		zz_append_child(ret, zz_copy_recursive(tree, iter));
 	return ret;
 }
 
+void zz_tree_set_consumer(struct zz_tree *tree,
+		void (*consumer)(struct zz_node *, void *), void *data)
+{
+	tree->consumer = consumer;
+	tree->consumer_data = data;
+}
+
+void zz_done(struct zz_tree *tree, struct zz_node *node)
+{
+	zz_unlink_child(node);
+	zz_list_init(&node->siblings);
+	if (tree->consumer != NULL)
+		tree->consumer(node, tree->consumer_data);
+	zz_recycle(tree, node);
+}
+
+void zz_recycle(struct zz_tree *tree, struct zz_node *node)
+{
+	struct zz_node *iter, *temp;
+	struct zz_tree_pool *pool = NULL;
+	struct zz_list *recycled;
+	size_t size;
+
+	zz_foreach_child_safe(iter, temp, node)
+		zz_recycle(tree, iter);
+#ifndef ZZ_COMPACT_DATA
+	if (zz_is_blob(node))
+		free_blob(tree, node->data);
+#endif
+	zz_data_destroy(node->data);
+	node->data = zz_null;
+	if (tree->indexed)
+		index_remove(tree, node);
+	if (zz_is_leaf(node)) {
+		recycled = &tree->recycled_leaves;
+		size = ZZ_LEAF_SIZE;
+	} else {
+		pool = node_pool(tree, node);
+		recycled = pool != NULL ? &pool->recycled : &tree->recycled;
+		size = pool_size(tree, pool);
+	}
+	zz_list_unlink(&node->allocated);
+	zz_list_append(recycled, &node->allocated);
+	--tree->num_nodes;
+	++tree->num_recycled;
+	tree->bytes_used -= size;
+	tree->bytes_recycled += size;
+}
+
+void zz_tree_stats(struct zz_tree *tree, struct zz_tree_stats *stats)
+{
+	struct zz_tree_cache *cache;
+	size_t arena_bytes;
+
+	stats->nodes = tree->num_nodes;
+	stats->bytes_used = tree->bytes_used;
+	cache = __atomic_load_n(&tree->caches, __ATOMIC_ACQUIRE);
+	for (; cache != NULL; cache = cache->next) {
+		stats->nodes += __atomic_load_n(&cache->num_nodes, __ATOMIC_RELAXED);
+		stats->bytes_used += __atomic_load_n(&cache->bytes_used,
+				__ATOMIC_RELAXED);
+	}
+	stats->recycled = tree->num_recycled;
+	stats->bytes_allocated = stats->bytes_used + tree->bytes_recycled;
+	if (tree->concurrent)
+		pthread_mutex_lock(&tree->arena_lock);
+	arena_bytes = tree->arena.bytes;
+	if (tree->concurrent)
+		pthread_mutex_unlock(&tree->arena_lock);
+	stats->bytes_used += arena_bytes;
+	stats->bytes_allocated += arena_bytes;
+}
+
+struct token_count {
+	const char *token;
+	size_t count;
+};
+
+static void count_token(struct token_count **table, size_t *size,
+		size_t *alloc, const char *token)
+{
+	struct token_count *old;
+	size_t i, j, old_alloc;
+
+	if (*size * 2 >= *alloc) {
+		old = *table;
+		old_alloc = *alloc;
+		*alloc = old_alloc ? old_alloc * 2 : 64;
+		*table = calloc(*alloc, sizeof(**table));
+		for (i = 0; i < old_alloc; ++i) {
+			if (old[i].token == NULL)
+				continue;
+			j = ((size_t)old[i].token >> 3) & (*alloc - 1);
+			while ((*table)[j].token != NULL)
+				j = (j + 1) & (*alloc - 1);
+			(*table)[j] = old[i];
+		}
+		free(old);
+	}
+	j = ((size_t)token >> 3) & (*alloc - 1);
+	while ((*table)[j].token != NULL && (*table)[j].token != token)
+		j = (j + 1) & (*alloc - 1);
+	if ((*table)[j].token == NULL) {
+		(*table)[j].token = token;
+		++*size;
+	}
+	++(*table)[j].count;
+}
+
+void zz_tree_token_stats(struct zz_tree *tree,
+		void (*fn)(const char *, size_t, void *), void *data)
+{
+	struct token_count *table = NULL;
+	struct zz_tree_cache *cache;
+	struct zz_node *n;
+	size_t size = 0, alloc = 0, i;
+
+	zz_list_foreach_entry(n, &tree->nodes, allocated)
+		count_token(&table, &size, &alloc, n->token);
+	for (cache = tree->caches; cache != NULL; cache = cache->next)
+		zz_list_foreach_entry(n, &cache->nodes, allocated)
+			count_token(&table, &size, &alloc, n->token);
+	for (i = 0; i < alloc; ++i)
+		if (table[i].token != NULL)
+			fn(table[i].token, table[i].count, data);
+	free(table);
+}
@@ -3,6 +3,11 @@
 #ifndef ZEBU_TREE_H_
 #define ZEBU_TREE_H_
 
+#include <pthread.h>
+
+#include "alloc.h"
+#include "arena.h"
+#include "column.h"
 #include "node.h"
 
 #ifdef __cplusplus
@@ -14,6 +19,12 @@ extern "C" {
  * ----
  */
 
+/**
+ * Size classes of blob storage: blocks of ``16 << class`` bytes, enough for
+ * the longest blob
+ */
+#define ZZ_BLOB_CLASSES 29
+
 /**
  * Abstract Syntax Tree
  *
@@ -23,6 +34,73 @@ extern "C" {
 struct zz_tree {
 	size_t node_size;
 	struct zz_list nodes;
+	struct zz_list recycled;
+	struct zz_list recycled_leaves;
+	void (*consumer)(struct zz_node *, void *);
+	void *consumer_data;
+	unsigned long id;
+	int concurrent;
+	struct zz_tree_cache *caches;
+	size_t num_nodes;
+	size_t num_recycled;
+	const struct zz_allocator *allocator;
+	struct zz_arena arena;
+	pthread_mutex_t arena_lock;
+	void *free_blobs[ZZ_BLOB_CLASSES];
+	struct zz_token_size *token_sizes;
+	size_t num_token_sizes;
+	size_t token_sizes_alloc;
+	struct zz_tree_pool **pools;
+	size_t num_pools;
+	size_t bytes_used;
+	size_t bytes_recycled;
+	unsigned int next_node_id;
+	int indexed;
+	struct zz_token_index *index;
+	size_t num_indexed;
+	size_t index_alloc;
+	struct zz_column index_slots;
+};
+
+/**
+ * Nodes of one size other than the default, and the recycled ones; nodes keep
+ * the number of their pool, starting at 1, in their flags
+ */
+struct zz_tree_pool {
+	unsigned int number;
+	size_t size;
+	struct zz_list recycled;
+};
+
+/**
+ * Pool of the nodes of a token, in an open-addressing table keyed by the
+ * token pointer
+ */
+struct zz_token_size {
+	const char *token;
+	struct zz_tree_pool *pool;
+};
+
+/**
+ * Live nodes of a token, in an open-addressing table keyed by the token
+ * pointer
+ */
+struct zz_token_index {
+	const char *token;
+	struct zz_node **nodes;
+	size_t size;
+	size_t alloc;
+};
+
+/**
+ * Nodes created by one thread in a concurrent tree
+ */
+struct zz_tree_cache {
+	struct zz_tree_cache *next;
+	pthread_t owner;
+	struct zz_list nodes;
+	size_t num_nodes;
+	size_t bytes_used;
 };
 
 /**
@@ -33,17 +111,159 @@ void zz_tree_init(struct zz_tree *tree, size_t node_size);
  * Destroy tree 
  */
 void zz_tree_destroy(struct zz_tree *tree);
+/**
+ * Free the recycled nodes, token sizes and arena of a tree whose live nodes
+ * have already been freed; this is the last step of zz_tree_destroy(), for
+ * functions that free the nodes on their own, like zz_tree_destroy_parallel().
+ */
+void zz_tree_release(struct zz_tree *tree);
+/**
+ * Give nodes of ``token`` a size of ``size`` bytes instead of the node size of
+ * the tree, so that only the tokens that need extra fields pay for them; nodes
+ * of each size are recycled separately. Must be called before creating any
+ * node. Leaves always take ``ZZ_LEAF_SIZE`` bytes. A node keeps the size it was
+ * created with, even if its token is changed afterwards.
+ */
+void zz_tree_set_token_size(struct zz_tree *tree, const char *token,
+		size_t size);
+/**
+ * Get the size of the nodes of ``token``
+ */
+size_t zz_tree_node_size(const struct zz_tree *tree, const char *token);
+/**
+ * Get the number of bytes allocated for ``node``
+ */
+size_t zz_tree_sizeof(const struct zz_tree *tree, const struct zz_node *node);
+/**
+ * Get the number of node ids handed out by the tree; every node has an id
+ * below it. Ids are only dense in trees that are not concurrent: concurrent
+ * trees and zz_copy_recursive_parallel() may leave gaps.
+ */
+unsigned int zz_tree_num_ids(const struct zz_tree *tree);
+/**
+ * Take memory for nodes from ``allocator`` instead of the C library; must be
+ * called before creating any node or setting token sizes, and ``allocator``
+ * must outlive the tree.
+ * The allocator must be thread-safe if the tree is concurrent, or is used by
+ * zz_copy_recursive_parallel().
+ */
+void zz_tree_set_allocator(struct zz_tree *tree,
+		const struct zz_allocator *allocator);
+/**
+ * Allow several threads to create nodes in the tree at the same time. Each
+ * thread keeps the nodes it creates in a cache of its own, that is registered
+ * in the tree the first time it creates a node; other operations on the tree,
+ * including recycling nodes, must still be done by one thread at a time.
+ */
+void zz_tree_set_concurrent(struct zz_tree *tree, int concurrent);
+/**
+ * Move the nodes in the caches of all threads to the node list of the tree;
+ * must be called when no other thread is creating nodes.
+ */
+void zz_tree_sync(struct zz_tree *tree);
+/**
+ * Move the live nodes, counters and arena of ``src`` to ``tree``, leaving
+ * ``src`` empty; both must use the same allocator, and the nodes of ``src``
+ * must have been given ids of ``tree``, as zz_copy_recursive_parallel() does.
+ */
+void zz_tree_merge(struct zz_tree *tree, struct zz_tree *src);
+
+/**
+ * Index
+ * -----
+ *
+ * A tree can keep the live nodes of each token in an array, so that finding
+ * all the nodes of a kind takes time proportional to their number instead of
+ * walking the tree. The index is kept up to date by zz_node(), zz_recycle()
+ * and zz_tree_merge(); nodes created by other threads in a concurrent tree are
+ * indexed when zz_tree_sync() moves them to the tree. zz_destroy() leaves
+ * indexed nodes alone, so they must be recycled instead. Nodes are listed in
+ * no particular order, under the token they had when they were indexed, so
+ * tokens must be changed with zz_set_token() for the index to follow.
+ */
+
+/**
+ * Start or stop indexing the nodes of the tree by token; starting indexes all
+ * the live nodes, so it must be called when no other thread is creating nodes.
+ */
+void zz_tree_set_indexed(struct zz_tree *tree, int indexed);
+/**
+ * Get the live nodes of ``token`` and their number in ``count``; the array is
+ * only valid until the next node is created or recycled.
+ */
+struct zz_node **zz_tree_token_nodes(struct zz_tree *tree, const char *token,
+		size_t *count);
+
+/**
+ * Memory usage of a tree
+ */
+struct zz_tree_stats {
+	size_t nodes;
+	size_t recycled;
+	size_t bytes_allocated;
+	size_t bytes_used;
+};
+
+/**
+ * Get number of live and recycled nodes in the tree, and the bytes allocated
+ * for all of them and used by the live ones, plus those of the tree arena;
+ * this only reads counters that are kept up to date by zz_node() and
+ * zz_recycle(), taking the arena lock of a concurrent tree, and is safe to
+ * call while other threads create nodes in it. Nodes freed with zz_destroy()
+ * bypass the tree and are not accounted for.
+ */
+void zz_tree_stats(struct zz_tree *tree, struct zz_tree_stats *stats);
+/**
+ * Call ``fn`` once for every distinct token in the tree, with the number of
+ * live nodes that have it and ``data``; walks all nodes, so it must not be
+ * called while other threads create nodes.
+ */
+void zz_tree_token_stats(struct zz_tree *tree,
+		void (*fn)(const char *, size_t, void *), void *data);
 
 /**
  * Create a node 
  */
 struct zz_node *zz_node(struct zz_tree *tree, const char *tok, struct zz_data data);
+/**
+ * Create a leaf node, that takes ``ZZ_LEAF_SIZE`` bytes instead of the node
+ * size, and can't have children nor extra fields
+ */
+struct zz_node *zz_leaf(struct zz_tree *tree, const char *tok,
+		struct zz_data data);
 /**
  * Destroy a node 
  */
 void zz_unref(struct zz_node *n);
 /**
- * Copy a node 
+ * Allocate ``size`` bytes aligned to ``align`` from the arena of the tree; the
+ * memory is freed when the tree is destroyed.
+ */
+void *zz_tree_alloc(struct zz_tree *tree, size_t size, size_t align);
+#ifndef ZZ_COMPACT_DATA
+/**
+ * Create a blob with a copy of the ``length`` bytes at ``data`` in the arena
+ * of the tree; it must be the payload of a single node of that tree, and its
+ * bytes are reused for new blobs once that node is recycled, so that streaming
+ * trees don't grow. Use zz_copy() to give another node the same bytes.
+ */
+struct zz_data zz_blob(struct zz_tree *tree, const void *data, size_t length);
+#endif
+/**
+ * Reset the payload of ``node`` to ``data``, destroying the old one, and
+ * reusing its storage if it was a blob
+ */
+void zz_set_data(struct zz_tree *tree, struct zz_node *node,
+		struct zz_data data);
+/**
+ * Change the token of ``node`` and move it to the index entry of ``token``;
+ * returns -1 and leaves the node alone if it is smaller than the nodes of
+ * ``token``, 0 otherwise
+ */
+int zz_set_token(struct zz_tree *tree, struct zz_node *node,
+		const char *token);
+/**
+ * Copy a node; blobs are copied into the arena of ``tree``
  */
 struct zz_node *zz_copy(struct zz_tree *tree, struct zz_node *node);
 /**
@@ -51,6 +271,36 @@ struct zz_node *zz_copy(struct zz_tree *tree, struct zz_node *node);
  */
 struct zz_node *zz_copy_recursive(struct zz_tree *tree, struct zz_node *node);
 
+/**
+ * Streaming
+ * ---------
+ *
+ * A tree can be used in bounded memory by handing every completed subtree to
+ * a consumer as soon as it is built, and then recycling its nodes; recycled
+ * nodes are reused by subsequent calls to zz_node(), so a parser that emits
+ * each top-level element will run in memory proportional to the largest
+ * element rather than to the whole input.
+ */
+
+/**
+ * Set the function that will receive completed subtrees, and a pointer to user
+ * data that will be passed to it; ``consumer`` may be ``NULL``, in which case
+ * completed subtrees are just recycled.
+ */
+void zz_tree_set_consumer(struct zz_tree *tree,
+		void (*consumer)(struct zz_node *, void *), void *data);
+/**
+ * Mark subtree as completed. Unlinks ``node`` from its parent, hands it to the
+ * consumer, and recycles it and all its children once the consumer returns;
+ * the consumer must not keep references to any of them.
+ */
+void zz_done(struct zz_tree *tree, struct zz_node *node);
+/**
+ * Recycle a node and all its children recursively, destroying their payloads;
+ * ``node`` must already be unlinked from its parent.
+ */
+void zz_recycle(struct zz_tree *tree, struct zz_node *node);
+
 #ifdef __cplusplus
 }
 #endif
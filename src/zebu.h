@@ -5,5 +5,14 @@
 
 #include "tree.h"
 #include "print.h"
+#include "pipeline.h"
+#include "parallel.h"
+#include "trace.h"
+#include "literal.h"
+#include "column.h"
+#include "order.h"
+#include "pattern.h"
+#include "rewrite.h"
+#include "bytecode.h"
 
 #endif       // ZEBU_H_
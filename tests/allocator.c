@@ -0,0 +1,96 @@
+/*
+ * Test for custom allocators
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+#include "../src/dict.h"
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+
+struct counter {
+	size_t allocs;
+	size_t frees;
+	size_t bytes;
+};
+
+static void *counted_alloc(void *ctx, size_t size)
+{
+	struct counter *c = ctx;
+	++c->allocs;
+	c->bytes += size;
+	return malloc(size);
+}
+
+static void *counted_realloc(void *ctx, void *ptr, size_t old_size, size_t size)
+{
+	struct counter *c = ctx;
+	c->bytes += size - old_size;
+	return realloc(ptr, size);
+}
+
+static void counted_free(void *ctx, void *ptr, size_t size)
+{
+	struct counter *c = ctx;
+	++c->frees;
+	c->bytes -= size;
+	free(ptr);
+}
+
+int main(int argc, char *argv[])
+{
+	struct counter nodes = { 0 }, strings = { 0 };
+	struct zz_allocator node_allocator = {
+		counted_alloc, counted_realloc, counted_free, &nodes
+	};
+	struct zz_allocator string_allocator = {
+		counted_alloc, counted_realloc, counted_free, &strings
+	};
+	struct zz_tree tree;
+	struct zz_node *root, *n;
+
+	zz_string_set_allocator(&string_allocator);
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_set_allocator(&tree, &node_allocator);
+	root = zz_node(&tree, TOK_FOO, zz_string("root"));
+	zz_append_child(root, zz_node(&tree, TOK_BAR, zz_string("child")));
+	n = zz_node(&tree, TOK_BAR, zz_string("child"));
+	zz_append_child(root, n);
+	zz_append_child(root, zz_copy_recursive(&tree, root));
+	assert(nodes.allocs == 6);
+	assert(nodes.bytes == 6 * sizeof(struct zz_node));
+	assert(strings.allocs == 4);
+	assert(strings.bytes == 2 * sizeof(struct zz_dict) + sizeof("root") +
+			sizeof("child"));
+
+	zz_unlink_child(n);
+	zz_recycle(&tree, n);
+	assert(nodes.frees == 0);
+	assert(zz_node(&tree, TOK_FOO, zz_null) == n);
+	assert(nodes.allocs == 6);
+
+	zz_tree_destroy(&tree);
+	assert(nodes.frees == nodes.allocs);
+	assert(nodes.bytes == 0);
+	assert(strings.frees == strings.allocs);
+	assert(strings.bytes == 0);
+
+	/* Token sizes take their memory from the allocator too */
+	memset(&nodes, 0, sizeof(nodes));
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_set_allocator(&tree, &node_allocator);
+	zz_tree_set_token_size(&tree, TOK_FOO, sizeof(struct zz_node) + 8);
+	zz_tree_set_token_size(&tree, TOK_BAR, sizeof(struct zz_node) + 16);
+	assert(nodes.allocs > 0);
+	zz_recycle(&tree, zz_node(&tree, TOK_FOO, zz_null));
+	zz_tree_destroy(&tree);
+	assert(nodes.frees == nodes.allocs);
+	assert(nodes.bytes == 0);
+
+	zz_string_set_allocator(NULL);
+	exit(EXIT_SUCCESS);
+}
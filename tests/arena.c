@@ -0,0 +1,169 @@
+/*
+ * Test for arenas, and the wide payloads stored in them
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+
+static void test_arena(void)
+{
+	struct zz_arena a, b;
+	char *p, *q;
+	double *d;
+
+	zz_arena_init(&a, NULL);
+	zz_arena_init(&b, NULL);
+
+	p = zz_arena_alloc(&a, 3, 1);
+	d = zz_arena_alloc(&a, sizeof(*d), sizeof(*d));
+	assert(((uintptr_t)d & (sizeof(*d) - 1)) == 0);
+	assert((char *)d >= p + 3);
+	memset(p, 'x', 3);
+	*d = 0.5;
+
+	q = zz_arena_alloc(&a, ZZ_ARENA_CHUNK_SIZE * 2, 1);
+	memset(q, 'y', ZZ_ARENA_CHUNK_SIZE * 2);
+	assert(a.bytes > ZZ_ARENA_CHUNK_SIZE * 3);
+	/* The large block doesn't retire the chunk still in use */
+	assert(zz_arena_alloc(&a, 1, 1) == (char *)(d + 1));
+
+	zz_arena_alloc(&b, 16, 1);
+	zz_arena_merge(&a, &b);
+	assert(b.chunks == NULL && b.bytes == 0);
+	assert(a.bytes > ZZ_ARENA_CHUNK_SIZE * 4);
+	assert(*d == 0.5 && p[2] == 'x');
+
+	zz_arena_destroy(&a);
+	zz_arena_destroy(&b);
+}
+
+#ifndef ZZ_COMPACT_DATA
+static void check_print(struct zz_node *node, const char *expected)
+{
+	char *buf;
+	size_t size;
+	FILE *f;
+
+	f = open_memstream(&buf, &size);
+	zz_print(node, f);
+	fclose(f);
+	assert(strcmp(buf, expected) == 0);
+	free(buf);
+}
+
+static void test_payloads(void)
+{
+	/* 2^64 + 1 */
+	static const unsigned char wide[] = { 1, 0, 0, 0, 0, 0, 0, 0, 1, 0 };
+	struct zz_tree tree, copy;
+	struct zz_node *root, *node, *sample;
+	const unsigned char *blob;
+	struct zz_tree_stats stats;
+	size_t length;
+	int i;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	root = zz_node(&tree, TOK_FOO, zz_int64(INT64_MIN));
+	assert(zz_get_int64(root) == INT64_MIN);
+	node = zz_node(&tree, TOK_BAR, zz_uint64(UINT64_MAX));
+	assert(zz_get_uint64(node) == UINT64_MAX);
+	zz_append_child(root, node);
+	node = zz_node(&tree, TOK_BAR, zz_blob(&tree, wide, sizeof(wide)));
+	assert(zz_is_blob(node));
+	blob = zz_get_blob(node, &length);
+	assert(length == sizeof(wide) && memcmp(blob, wide, length) == 0);
+	assert(blob != wide);
+	zz_append_child(root, node);
+	node = zz_node(&tree, TOK_BAR, zz_blob(&tree, wide, 0));
+	zz_append_child(root, node);
+	check_print(root, "[foo -9223372036854775808 [bar 18446744073709551615]"
+			" [bar 0x10000000000000001] [bar 0x0]]");
+
+	zz_tree_stats(&tree, &stats);
+	assert(stats.bytes_used >= 4 * sizeof(struct zz_node) +
+			ZZ_ARENA_CHUNK_SIZE);
+
+	/* Copies own their blobs */
+	zz_tree_init(&copy, sizeof(struct zz_node));
+	sample = zz_copy_recursive(&copy, root);
+	for (i = 0; i < 64; ++i)
+		zz_append_child(root, zz_copy_recursive(&tree, sample));
+	root = zz_copy_recursive_parallel(&copy, root, 4);
+	zz_tree_destroy(&tree);
+	check_print(sample, "[foo -9223372036854775808 [bar 18446744073709551615]"
+			" [bar 0x10000000000000001] [bar 0x0]]");
+	zz_foreach_child(node, root) {
+		if (!zz_is_blob(node))
+			continue;
+		blob = zz_get_blob(node, &length);
+		assert(length == 0 || blob[8] == 1);
+	}
+	check_print(zz_last_child(root), "[foo -9223372036854775808"
+			" [bar 18446744073709551615] [bar 0x10000000000000001]"
+			" [bar 0x0]]");
+	zz_tree_destroy_parallel(&copy, 4);
+}
+
+static void check_blob(struct zz_node *node, void *data)
+{
+	const unsigned char *blob;
+	size_t length, i;
+
+	blob = zz_get_blob(zz_first_child(node), &length);
+	assert(length == zz_get_uint(node));
+	for (i = 0; i < length; ++i)
+		assert(blob[i] == (unsigned char)(length + i));
+	++*(size_t *)data;
+}
+
+/* Blobs of recycled nodes are reused, so streaming doesn't grow the arena */
+static void test_streaming(void)
+{
+	unsigned char bytes[100];
+	struct zz_tree tree;
+	struct zz_node *node;
+	size_t count = 0, bytes_before = 0;
+	unsigned int i, j, length;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_set_consumer(&tree, check_blob, &count);
+	for (i = 0; i < 10000; ++i) {
+		if (i == 1000)
+			bytes_before = tree.arena.bytes;
+		length = i * 7 % sizeof(bytes);
+		for (j = 0; j < length; ++j)
+			bytes[j] = length + j;
+		node = zz_node(&tree, TOK_FOO, zz_uint(length));
+		zz_append_child(node, zz_leaf(&tree, TOK_BAR,
+					zz_blob(&tree, bytes, length)));
+		zz_done(&tree, node);
+	}
+	assert(count == 10000);
+	assert(tree.arena.bytes == bytes_before);
+
+	/* Replacing a blob payload reuses its storage too */
+	node = zz_leaf(&tree, TOK_BAR, zz_null);
+	for (i = 0; i < 10000; ++i)
+		zz_set_data(&tree, node, zz_blob(&tree, bytes, 50));
+	zz_set_data(&tree, node, zz_int(1));
+	assert(tree.arena.bytes == bytes_before);
+	zz_tree_destroy(&tree);
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+	test_arena();
+#ifndef ZZ_COMPACT_DATA
+	test_payloads();
+	test_streaming();
+#endif
+	exit(EXIT_SUCCESS);
+}
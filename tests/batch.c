@@ -0,0 +1,140 @@
+/*
+ * Test for batch evaluation of bytecode over columns of inputs
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_NUM = "num";
+static const char *TOK_ADD = "add";
+static const char *TOK_SUB = "sub";
+static const char *TOK_MUL = "mul";
+static const char *TOK_DIV = "div";
+static const char *TOK_NEG = "neg";
+static const char *TOK_VAR = "var";
+static const char *TOK_MAX = "max";
+
+#define NUM_INPUTS 3
+#define MAX_ROWS 1000
+
+static const size_t ROWS[] = { 0, 1, 255, 256, 257, 1000 };
+
+static double maximum(const double *args, unsigned int arity, void *data)
+{
+	double ret = args[0];
+	unsigned int i;
+
+	*(size_t *)data += 1;
+	for (i = 1; i < arity; ++i)
+		if (args[i] > ret)
+			ret = args[i];
+	return ret;
+}
+
+static struct zz_node *generate(struct zz_tree *tree, int depth,
+		unsigned int *seed)
+{
+	static const char *const *ops[] = { &TOK_ADD, &TOK_SUB, &TOK_MUL,
+		&TOK_DIV, &TOK_NEG, &TOK_MAX };
+	struct zz_node *n;
+	int i, arity;
+
+	*seed = *seed * 1103515245 + 12345;
+	if (depth == 0 || (*seed >> 16) % 4 == 0) {
+		if ((*seed >> 8) % 3 == 0)
+			return zz_leaf(tree, TOK_NUM, zz_double(0.1 * (*seed % 7)));
+		return zz_leaf(tree, TOK_VAR,
+				zz_int((*seed >> 4) % NUM_INPUTS));
+	}
+	n = zz_node(tree, *ops[(*seed >> 16) % 6], zz_null);
+	if (n->token == TOK_NEG)
+		arity = 1;
+	else if (n->token == TOK_MAX)
+		arity = 1 + (*seed >> 8) % 3;
+	else
+		arity = 2;
+	for (i = 0; i < arity; ++i)
+		zz_append_child(n, generate(tree, depth - 1, seed));
+	return n;
+}
+
+int main(int argc, char *argv[])
+{
+	static double columns[NUM_INPUTS][MAX_ROWS];
+	static double out[MAX_ROWS + 1];
+	const double *inputs[NUM_INPUTS];
+	double row[NUM_INPUTS], expected;
+	struct zz_program program;
+	struct zz_tree tree;
+	struct zz_node *root;
+	unsigned int seed = 11;
+	size_t calls = 0, i, j, k, r;
+
+	setvbuf(stdout, NULL, _IONBF, 0);
+	for (i = 0; i < NUM_INPUTS; ++i) {
+		for (r = 0; r < MAX_ROWS; ++r)
+			columns[i][r] = (double)(r * (i + 3) % 17) - 8 +
+				0.25 * i;
+		inputs[i] = columns[i];
+	}
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_program_init(&program);
+	zz_program_opcode(&program, TOK_NUM, ZZ_OP_CONST);
+	zz_program_opcode(&program, TOK_VAR, ZZ_OP_INPUT);
+	zz_program_opcode(&program, TOK_ADD, ZZ_OP_ADD);
+	zz_program_opcode(&program, TOK_SUB, ZZ_OP_SUB);
+	zz_program_opcode(&program, TOK_MUL, ZZ_OP_MUL);
+	zz_program_opcode(&program, TOK_DIV, ZZ_OP_DIV);
+	zz_program_opcode(&program, TOK_NEG, ZZ_OP_NEG);
+	zz_program_function(&program, TOK_MAX, maximum, &calls);
+
+	/* (var0 + 2) * -var1 */
+	root = zz_node(&tree, TOK_MUL, zz_null);
+	zz_append_child(root, zz_node(&tree, TOK_ADD, zz_null));
+	zz_append_child(zz_first_child(root),
+			zz_leaf(&tree, TOK_VAR, zz_int(0)));
+	zz_append_child(zz_first_child(root),
+			zz_leaf(&tree, TOK_NUM, zz_int(2)));
+	zz_append_child(root, zz_node(&tree, TOK_NEG, zz_null));
+	zz_append_child(zz_last_child(root),
+			zz_leaf(&tree, TOK_VAR, zz_int(1)));
+	/* A program without code gives NaN for every row */
+	zz_program_run_batch(&program, inputs, 3, out);
+	assert(isnan(out[0]) && isnan(out[1]) && isnan(out[2]));
+
+	zz_print(root, stdout);
+	printf("\n");
+	assert(zz_program_compile(&program, root) == 0);
+	zz_program_run_batch(&program, inputs, 5, out);
+	for (r = 0; r < 5; ++r)
+		printf("%g\n", out[r]);
+
+	/* Same results as evaluating row by row, bit for bit */
+	for (i = 0; i < 200; ++i) {
+		root = generate(&tree, 1 + i % 8, &seed);
+		assert(zz_program_compile(&program, root) == 0);
+		for (k = 0; k < sizeof(ROWS) / sizeof(ROWS[0]); ++k) {
+			out[ROWS[k]] = 42;
+			calls = 0;
+			zz_program_run_batch(&program, inputs, ROWS[k], out);
+			assert(out[ROWS[k]] == 42);
+			/* Functions are only called for actual rows */
+			assert(calls % (ROWS[k] ? ROWS[k] : 1) == 0);
+			for (r = 0; r < ROWS[k]; ++r) {
+				for (j = 0; j < NUM_INPUTS; ++j)
+					row[j] = columns[j][r];
+				expected = zz_program_run(&program, row);
+				assert(memcmp(&out[r], &expected,
+							sizeof(expected)) == 0);
+			}
+		}
+	}
+
+	zz_program_destroy(&program);
+	zz_tree_destroy(&tree);
+	exit(EXIT_SUCCESS);
+}
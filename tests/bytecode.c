@@ -0,0 +1,199 @@
+/*
+ * Test for the bytecode compiler and interpreter
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_NUM = "num";
+static const char *TOK_ADD = "add";
+static const char *TOK_SUB = "sub";
+static const char *TOK_MUL = "mul";
+static const char *TOK_DIV = "div";
+static const char *TOK_EXP = "exp";
+static const char *TOK_NEG = "neg";
+static const char *TOK_VAR = "var";
+static const char *TOK_MIN = "min";
+
+static struct zz_node *op(struct zz_tree *tree, const char *token,
+		struct zz_node *a, struct zz_node *b)
+{
+	struct zz_node *n = zz_node(tree, token, zz_null);
+
+	zz_append_child(n, a);
+	if (b != NULL)
+		zz_append_child(n, b);
+	return n;
+}
+
+static double power(const double *args, unsigned int arity, void *data)
+{
+	double ret = 1;
+	int i;
+
+	for (i = 0; i < args[1]; ++i)
+		ret *= args[0];
+	return ret;
+}
+
+static double minimum(const double *args, unsigned int arity, void *data)
+{
+	double ret = args[0];
+	unsigned int i;
+
+	++*(int *)data;
+	for (i = 1; i < arity; ++i)
+		if (args[i] < ret)
+			ret = args[i];
+	return ret;
+}
+
+/* Reference evaluator, walking the tree */
+static double walk(struct zz_node *n, const double *inputs)
+{
+	struct zz_node *a = zz_first_child(n), *b = zz_last_child(n);
+	double args[2];
+
+	if (n->token == TOK_NUM)
+		return zz_is_double(n) ? zz_get_double(n) : zz_get_int(n);
+	if (n->token == TOK_VAR)
+		return inputs[zz_get_int(n)];
+	if (n->token == TOK_NEG)
+		return -walk(a, inputs);
+	if (n->token == TOK_ADD)
+		return walk(a, inputs) + walk(b, inputs);
+	if (n->token == TOK_SUB)
+		return walk(a, inputs) - walk(b, inputs);
+	if (n->token == TOK_MUL)
+		return walk(a, inputs) * walk(b, inputs);
+	if (n->token == TOK_DIV)
+		return walk(a, inputs) / walk(b, inputs);
+	args[0] = walk(a, inputs);
+	args[1] = walk(b, inputs);
+	return power(args, 2, NULL);
+}
+
+static struct zz_node *generate(struct zz_tree *tree, int depth,
+		unsigned int *seed)
+{
+	static const char *const *ops[] = { &TOK_ADD, &TOK_SUB, &TOK_MUL,
+		&TOK_DIV, &TOK_NEG };
+	const char *token;
+
+	*seed = *seed * 1103515245 + 12345;
+	if (depth == 0 || (*seed >> 16) % 4 == 0) {
+		if ((*seed >> 8) % 3 == 0)
+			return zz_leaf(tree, TOK_VAR, zz_int((*seed >> 4) % 3));
+		if ((*seed >> 8) % 3 == 1)
+			return zz_leaf(tree, TOK_NUM, zz_double(0.1 * (*seed % 7)));
+		return zz_leaf(tree, TOK_NUM, zz_int((*seed >> 4) % 10));
+	}
+	token = *ops[(*seed >> 16) % 5];
+	return op(tree, token, generate(tree, depth - 1, seed),
+			token == TOK_NEG ? NULL : generate(tree, depth - 1, seed));
+}
+
+static int same(double a, double b)
+{
+	return memcmp(&a, &b, sizeof(a)) == 0 || (a != a && b != b);
+}
+
+int main(int argc, char *argv[])
+{
+	const double inputs[] = { 1.5, -2, 10 };
+	struct zz_program program;
+	struct zz_tree tree;
+	struct zz_node *root, *n;
+	unsigned int seed = 7;
+	int calls = 0, i;
+
+	setvbuf(stdout, NULL, _IONBF, 0);
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_program_init(&program);
+	zz_program_opcode(&program, TOK_NUM, ZZ_OP_CONST);
+	zz_program_opcode(&program, TOK_ADD, ZZ_OP_ADD);
+	zz_program_opcode(&program, TOK_SUB, ZZ_OP_SUB);
+	zz_program_opcode(&program, TOK_MUL, ZZ_OP_MUL);
+	zz_program_opcode(&program, TOK_DIV, ZZ_OP_DIV);
+	zz_program_opcode(&program, TOK_NEG, ZZ_OP_NEG);
+	zz_program_function(&program, TOK_EXP, power, NULL);
+
+	/* (3 + 4) * 2 ^ 3 n - 10 / 4 */
+	root = op(&tree, TOK_SUB,
+		op(&tree, TOK_MUL,
+			op(&tree, TOK_ADD, zz_leaf(&tree, TOK_NUM, zz_int(3)),
+				zz_leaf(&tree, TOK_NUM, zz_uint(4))),
+			op(&tree, TOK_NEG,
+				op(&tree, TOK_EXP,
+					zz_leaf(&tree, TOK_NUM, zz_int(2)),
+					zz_leaf(&tree, TOK_NUM, zz_int(3))),
+				NULL)),
+		op(&tree, TOK_DIV, zz_leaf(&tree, TOK_NUM, zz_double(10)),
+			zz_leaf(&tree, TOK_NUM, zz_uint(4))));
+	zz_print(root, stdout);
+	printf("\n");
+	assert(zz_program_compile(&program, root) == 0);
+	printf("%zu instructions, depth %u, inputs %u\n", program.size,
+			program.max_depth, program.num_inputs);
+	printf("%g\n", zz_program_run(&program, NULL));
+
+	/* Inputs are not known until they are registered */
+	n = op(&tree, TOK_MUL, zz_leaf(&tree, TOK_VAR, zz_int(2)),
+			zz_leaf(&tree, TOK_VAR, zz_int(0)));
+	assert(zz_program_compile(&program, n) == -1);
+	assert(program.size == 0);
+	assert(isnan(zz_program_run(&program, inputs)));
+	zz_program_opcode(&program, TOK_VAR, ZZ_OP_INPUT);
+	assert(zz_program_compile(&program, n) == 0);
+	printf("%zu instructions, depth %u, inputs %u\n", program.size,
+			program.max_depth, program.num_inputs);
+	printf("%g\n", zz_program_run(&program, inputs));
+
+	/* Functions take any number of arguments */
+	zz_program_function(&program, TOK_MIN, minimum, &calls);
+	n = zz_node(&tree, TOK_MIN, zz_null);
+	zz_append_child(n, zz_leaf(&tree, TOK_VAR, zz_int(2)));
+	zz_append_child(n, zz_leaf(&tree, TOK_VAR, zz_uint(1)));
+	zz_append_child(n, zz_leaf(&tree, TOK_NUM, zz_int(5)));
+	assert(zz_program_compile(&program, n) == 0);
+	printf("%g\n", zz_program_run(&program, inputs));
+	assert(calls == 1);
+
+	/* Wrong arities and payloads */
+	n = zz_node(&tree, TOK_ADD, zz_null);
+	zz_append_child(n, zz_leaf(&tree, TOK_NUM, zz_int(1)));
+	assert(zz_program_compile(&program, n) == -1);
+	n = zz_leaf(&tree, TOK_NUM, zz_string("one"));
+	assert(zz_program_compile(&program, n) == -1);
+	n = zz_leaf(&tree, TOK_VAR, zz_int(-1));
+	assert(zz_program_compile(&program, n) == -1);
+	n = op(&tree, TOK_NEG, zz_leaf(&tree, TOK_NUM, zz_int(1)),
+			zz_leaf(&tree, TOK_NUM, zz_int(2)));
+	assert(zz_program_compile(&program, n) == -1);
+
+	/* Same results as walking the tree */
+	for (i = 0; i < 1000; ++i) {
+		root = generate(&tree, 1 + i % 10, &seed);
+		assert(zz_program_compile(&program, root) == 0);
+		assert(same(zz_program_run(&program, inputs),
+					walk(root, inputs)));
+	}
+
+	/* Deep trees, with a stack that doesn't fit in the local buffer */
+	root = zz_leaf(&tree, TOK_NUM, zz_int(1));
+	for (i = 1; i < 100000; ++i)
+		root = op(&tree, TOK_ADD, zz_leaf(&tree, TOK_NUM, zz_int(1)),
+				root);
+	assert(zz_program_compile(&program, root) == 0);
+	printf("%zu instructions, depth %u, inputs %u\n", program.size,
+			program.max_depth, program.num_inputs);
+	printf("%g\n", zz_program_run(&program, NULL));
+
+	zz_program_destroy(&program);
+	zz_tree_destroy(&tree);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,132 @@
+/*
+ * Test for node ids and attribute columns
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_ADD = "add";
+static const char *TOK_NUM = "num";
+
+struct symbol {
+	const char *name;
+	int scope;
+};
+
+static struct zz_node *build(struct zz_tree *tree, int width)
+{
+	struct zz_node *add;
+	int i;
+
+	add = zz_node(tree, TOK_ADD, zz_null);
+	for (i = 0; i < width; ++i)
+		zz_append_child(add, zz_leaf(tree, TOK_NUM, zz_int(i)));
+	return add;
+}
+
+/* Check that the ids of the subtree are below ``num_ids`` and unique */
+static void check_ids(struct zz_node *node, unsigned int num_ids,
+		struct zz_column *seen)
+{
+	struct zz_node *iter;
+
+	assert(node->id < num_ids);
+	assert(!zz_column_ref(seen, node, char));
+	zz_column_ref(seen, node, char) = 1;
+	zz_foreach_child(iter, node)
+		check_ids(iter, num_ids, seen);
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree, copy;
+	struct zz_column types, symbols, seen;
+	struct zz_node *root, *add, *iter;
+	struct symbol *sym;
+	int i;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	assert(zz_tree_num_ids(&tree) == 0);
+	root = build(&tree, 10);
+	assert(zz_tree_num_ids(&tree) == 11);
+	assert(root->id == 0);
+	i = 1;
+	zz_foreach_child(iter, root)
+		assert(iter->id == i++);
+
+	/* Columns are empty until values are set, and read as zero */
+	zz_column_init(&types, sizeof(int), NULL);
+	zz_column_init(&symbols, sizeof(struct symbol), NULL);
+	assert(zz_column_get(&types, root) == NULL);
+	zz_foreach_child(iter, root)
+		zz_column_ref(&types, iter, int) = zz_get_int(iter) * 2;
+	assert(zz_column_ref(&types, root, int) == 0);
+	zz_foreach_child(iter, root)
+		assert(*(const int *)zz_column_get(&types, iter) ==
+				zz_get_int(iter) * 2);
+	sym = zz_column_at(&symbols, zz_last_child(root));
+	sym->name = "x";
+	sym->scope = 3;
+	assert(zz_column_ref(&symbols, zz_first_child(root),
+				struct symbol).name == NULL);
+	assert(zz_column_ref(&symbols, zz_last_child(root),
+				struct symbol).scope == 3);
+
+	/* Columns grow with the tree */
+	for (i = 0; i < 100; ++i)
+		zz_append_child(root, build(&tree, 10));
+	zz_column_reserve(&types, zz_tree_num_ids(&tree));
+	assert(types.size >= zz_tree_num_ids(&tree));
+	add = zz_last_child(root);
+	assert(zz_column_get(&types, add) != NULL);
+	assert(*(const int *)zz_column_get(&types, add) == 0);
+	zz_column_ref(&types, add, int) = 7;
+	assert(zz_column_ref(&types, zz_first_child(root), int) == 0);
+	assert(zz_column_ref(&types, add, int) == 7);
+	zz_column_clear(&types);
+	assert(zz_column_ref(&types, add, int) == 0);
+
+	/* Columns are independent from the tree */
+	zz_column_destroy(&symbols);
+
+	/* Recycled nodes keep their ids */
+	zz_column_init(&seen, 1, NULL);
+	check_ids(add, zz_tree_num_ids(&tree), &seen);
+	zz_done(&tree, add);
+	add = build(&tree, 10);
+	assert(zz_tree_num_ids(&tree) == 11 + 100 * 11);
+	assert(zz_column_ref(&seen, add, char));
+	zz_foreach_child(iter, add)
+		assert(zz_column_ref(&seen, iter, char));
+	assert(zz_node(&tree, TOK_NUM, zz_null)->id == 11 + 100 * 11);
+	zz_column_destroy(&seen);
+
+	/* Copies number nodes in the destination tree */
+	zz_tree_init(&copy, sizeof(struct zz_node));
+	add = zz_copy_recursive(&copy, root);
+	assert(add->id == 0);
+	assert(zz_tree_num_ids(&copy) == 11 + 99 * 11);
+	zz_tree_destroy(&copy);
+	zz_tree_init(&copy, sizeof(struct zz_node));
+	zz_node(&copy, TOK_ADD, zz_null);
+	add = zz_copy_recursive_parallel(&copy, root, 4);
+	zz_column_init(&seen, 1, NULL);
+	check_ids(add, zz_tree_num_ids(&copy), &seen);
+	zz_column_destroy(&seen);
+	zz_tree_destroy(&copy);
+
+	zz_tree_destroy(&tree);
+	zz_column_destroy(&types);
+
+	/* Concurrent trees hand out unique ids too */
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_set_concurrent(&tree, 1);
+	assert(zz_node(&tree, TOK_NUM, zz_null)->id == 0);
+	assert(zz_leaf(&tree, TOK_NUM, zz_null)->id == 1);
+	assert(zz_tree_num_ids(&tree) == 2);
+	zz_tree_destroy(&tree);
+
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,90 @@
+/*
+ * Stress test for several threads creating nodes in the same tree
+ */
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+
+#define NUM_THREADS 8
+#define NUM_NODES 20000
+
+struct region {
+	pthread_t thread;
+	struct zz_tree *tree;
+	struct zz_node *root;
+	int index;
+};
+
+static void *parse(void *arg)
+{
+	struct region *r = arg;
+	struct zz_node *n;
+	char buf[32];
+	int i;
+
+	r->root = zz_node(r->tree, TOK_FOO, zz_int(r->index));
+	for (i = 0; i < NUM_NODES; ++i) {
+		snprintf(buf, sizeof(buf), "interned string %d", i % 100);
+		n = zz_node(r->tree, TOK_BAR, zz_string(buf));
+		zz_append_child(r->root, n);
+		/* Grow the arena as well, for zz_tree_stats() to read */
+		if (i % 100 == 0)
+			zz_tree_alloc(r->tree, 64, sizeof(double));
+	}
+	return NULL;
+}
+
+static size_t count_nodes(struct zz_list *list)
+{
+	struct zz_list *iter;
+	size_t count = 0;
+
+	zz_list_foreach(iter, list)
+		++count;
+	return count;
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree;
+	struct region regions[NUM_THREADS];
+	struct zz_tree_stats stats;
+	struct zz_node *root, *iter;
+	int i, round;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_set_concurrent(&tree, 1);
+	root = zz_node(&tree, TOK_FOO, zz_null);
+
+	for (round = 0; round < 2; ++round) {
+		for (i = 0; i < NUM_THREADS; ++i) {
+			regions[i].tree = &tree;
+			regions[i].index = i;
+			pthread_create(&regions[i].thread, NULL, parse, &regions[i]);
+		}
+		for (i = 0; i < 100; ++i) {
+			zz_tree_stats(&tree, &stats);
+			assert(stats.bytes_used <= stats.bytes_allocated);
+		}
+		for (i = 0; i < NUM_THREADS; ++i) {
+			pthread_join(regions[i].thread, NULL);
+			zz_append_child(root, regions[i].root);
+		}
+		zz_tree_sync(&tree);
+		assert(count_nodes(&tree.nodes) ==
+				1 + (round + 1) * NUM_THREADS * (NUM_NODES + 1));
+	}
+
+	i = 0;
+	zz_foreach_child(iter, root)
+		assert(zz_get_int(iter) == i++ % NUM_THREADS);
+	assert(i == 2 * NUM_THREADS);
+
+	zz_tree_destroy(&tree);
+	exit(EXIT_SUCCESS);
+}
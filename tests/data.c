@@ -6,10 +6,10 @@
 
 int main(int argc, char *argv[])
 {
-	struct zz_data d;
+	struct zz_data d, e;
 
 	d = zz_null;
-	assert(d.type == ZZ_NULL);
+	assert(zz_data_type(d) == ZZ_NULL);
 
 	d = zz_int(-42);
 	assert(zz_to_int(d) == -42);
@@ -18,12 +18,64 @@ int main(int argc, char *argv[])
 	assert(zz_to_uint(d) == 42);
 
 	d = zz_double(42);
+	assert(zz_data_type(d) == ZZ_DOUBLE);
 	assert(zz_to_double(d) == 42);
 
+	d = zz_double(-0.5);
+	assert(zz_to_double(d) == -0.5);
+
+	d = zz_double(0.0 / 0.0);
+	assert(zz_data_type(d) == ZZ_DOUBLE);
+	assert(zz_to_double(d) != zz_to_double(d));
+
 	d = zz_string("forty-two");
 	assert(strcmp(zz_to_string(d), "forty-two") == 0);
+	assert(zz_data_string(&d) == zz_to_string(d));
+	zz_data_destroy(d);
+
+	d = zz_string("42");
+	assert(zz_data_type(d) == ZZ_STRING);
+	assert(strcmp(zz_to_string(d), "42") == 0);
+	zz_data_destroy(d);
+
+	d = zz_short_string("42");
+	assert(zz_data_type(d) == ZZ_SHORT_STRING);
+	assert(strcmp(zz_data_string(&d), "42") == 0);
+	e = zz_data_copy(d);
+	assert(strcmp(zz_data_string(&e), "42") == 0);
+	zz_data_destroy(e);
+	zz_data_destroy(d);
+
+	d = zz_short_string(&"1234567"[7 - ZZ_SHORT_STRING_MAX]);
+	assert(zz_data_type(d) == ZZ_SHORT_STRING);
+	assert(strlen(zz_data_string(&d)) == ZZ_SHORT_STRING_MAX);
+	d = zz_short_string(&"12345678"[7 - ZZ_SHORT_STRING_MAX]);
+	assert(zz_data_type(d) == ZZ_STRING);
+	zz_data_destroy(d);
+
+#ifndef ZZ_COMPACT_DATA
+	{
+		char source[] = "int forty_two = 42;";
+		const char *slice;
+		size_t length;
+
+		d = zz_slice(source + 4, 9);
+		assert(zz_data_type(d) == ZZ_SLICE);
+		e = zz_data_copy(d);
+		slice = zz_to_slice(e, &length);
+		assert(slice == source + 4 && length == 9);
+		zz_data_destroy(e);
+
+		e = zz_data_intern(d);
+		source[4] = 'F';
+		assert(strcmp(zz_to_string(e), "forty_two") == 0);
+		assert(zz_data_intern(e).type == ZZ_STRING);
+		zz_data_destroy(e);
+	}
+#endif
 
 	d = zz_pointer(&d);
+	assert(zz_data_type(d) == ZZ_POINTER);
 	assert(zz_to_pointer(d) == &d);
 
 	exit(EXIT_SUCCESS);
@@ -121,11 +121,30 @@ void insert_twice(void)
 	zz_dict_destroy(dict);
 }
 
+void insert_ex(void)
+{
+	struct zz_dict *dict;
+	static const char str[] = "This is a string";
+	const char *s1, *s2;
+	int inserted;
+
+	dict = zz_dict_insert_ex(NULL, str, &s1, &inserted);
+	assert(inserted == 1);
+	dict = zz_dict_insert_ex(dict, str, &s2, &inserted);
+	assert(inserted == 0);
+	assert(s1 == s2);
+	dict = zz_dict_insert_ex(dict, "Another string", NULL, &inserted);
+	assert(inserted == 1);
+
+	zz_dict_destroy(dict);
+}
+
 int main(int argc, char *argv[])
 {
 	empty_dict();
 	insert_vals();
 	delete_vals();
 	insert_twice();
+	insert_ex();
 	exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,166 @@
+/*
+ * Test for the index of nodes by token
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_CALL = "call";
+static const char *TOK_IDENT = "ident";
+static const char *TOK_NUM = "num";
+
+static struct zz_node *build(struct zz_tree *tree, int width)
+{
+	struct zz_node *call;
+	int i;
+
+	call = zz_node(tree, TOK_CALL, zz_null);
+	zz_append_child(call, zz_leaf(tree, TOK_IDENT, zz_string("f")));
+	for (i = 0; i < width; ++i)
+		zz_append_child(call, zz_leaf(tree, TOK_NUM, zz_int(i)));
+	return call;
+}
+
+static size_t allocated;
+
+static void *counted_alloc(void *ctx, size_t size)
+{
+	allocated += size;
+	return malloc(size);
+}
+
+static void *counted_realloc(void *ctx, void *ptr, size_t old_size, size_t size)
+{
+	allocated += size - old_size;
+	return realloc(ptr, size);
+}
+
+static void counted_free(void *ctx, void *ptr, size_t size)
+{
+	allocated -= size;
+	free(ptr);
+}
+
+static const struct zz_allocator allocator = {
+	counted_alloc, counted_realloc, counted_free, NULL
+};
+
+/* Count nodes of token by walking the subtree */
+static size_t walk(struct zz_node *node, const char *token)
+{
+	struct zz_node *iter;
+	size_t ret = node->token == token;
+
+	zz_foreach_child(iter, node)
+		ret += walk(iter, token);
+	return ret;
+}
+
+/* Check that the index matches a walk of the tree */
+static void check(struct zz_tree *tree, struct zz_node *root)
+{
+	static const char **tokens[] = { &TOK_CALL, &TOK_IDENT, &TOK_NUM };
+	struct zz_node **nodes;
+	size_t count, i, j;
+
+	for (i = 0; i < 3; ++i) {
+		nodes = zz_tree_token_nodes(tree, *tokens[i], &count);
+		assert(count == walk(root, *tokens[i]));
+		for (j = 0; j < count; ++j)
+			assert(nodes[j]->token == *tokens[i]);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree, copy;
+	struct zz_node *root, *call, **nodes;
+	size_t count;
+	int i;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_set_indexed(&tree, 1);
+	zz_tree_token_nodes(&tree, TOK_CALL, &count);
+	assert(count == 0);
+	root = build(&tree, 5);
+	nodes = zz_tree_token_nodes(&tree, TOK_CALL, &count);
+	assert(count == 1 && nodes[0] == root);
+	zz_tree_token_nodes(&tree, "unknown", &count);
+	assert(count == 0);
+	for (i = 0; i < 100; ++i)
+		zz_append_child(root, build(&tree, i % 7));
+	check(&tree, root);
+
+	/* Recycled nodes leave the index */
+	for (i = 0; i < 50; ++i)
+		zz_done(&tree, zz_last_child(root));
+	check(&tree, root);
+	for (i = 0; i < 20; ++i)
+		zz_append_child(root, build(&tree, 3));
+	check(&tree, root);
+
+	/* Copies are indexed in the destination tree */
+	zz_tree_init(&copy, sizeof(struct zz_node));
+	zz_tree_set_indexed(&copy, 1);
+	call = zz_copy_recursive(&copy, root);
+	check(&copy, call);
+	zz_tree_destroy(&copy);
+	zz_tree_init(&copy, sizeof(struct zz_node));
+	zz_tree_set_indexed(&copy, 1);
+	call = zz_copy_recursive_parallel(&copy, root, 4);
+	check(&copy, call);
+	zz_tree_destroy_parallel(&copy, 4);
+
+	/* The index can be dropped and rebuilt from the live nodes */
+	zz_tree_set_indexed(&tree, 0);
+	zz_append_child(root, build(&tree, 3));
+	zz_tree_set_indexed(&tree, 1);
+	check(&tree, root);
+	zz_tree_destroy(&tree);
+
+	/* Retokened nodes still leave the index when recycled */
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_set_indexed(&tree, 1);
+	root = build(&tree, 3);
+	call = zz_node(&tree, TOK_CALL, zz_null);
+	call->token = TOK_NUM;
+	zz_recycle(&tree, call);
+	nodes = zz_tree_token_nodes(&tree, TOK_CALL, &count);
+	assert(count == 1 && nodes[0] == root);
+	/* zz_set_token() moves nodes to the entry of their new token */
+	call = zz_node(&tree, TOK_CALL, zz_null);
+	assert(zz_set_token(&tree, call, TOK_NUM) == 0);
+	nodes = zz_tree_token_nodes(&tree, TOK_CALL, &count);
+	assert(count == 1 && nodes[0] == root);
+	zz_append_child(root, call);
+	check(&tree, root);
+	/* Nodes can be destroyed once the tree stops indexing them */
+	zz_tree_set_indexed(&tree, 0);
+	call = zz_node(&tree, TOK_CALL, zz_null);
+	zz_destroy(call);
+	zz_tree_destroy(&tree);
+
+	/* The index takes its memory from the allocator of the tree */
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_set_allocator(&tree, &allocator);
+	zz_tree_set_indexed(&tree, 1);
+	root = build(&tree, 100);
+	check(&tree, root);
+	zz_tree_destroy(&tree);
+	assert(allocated == 0);
+
+	/* Nodes of concurrent trees are indexed when synced */
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_set_concurrent(&tree, 1);
+	zz_tree_set_indexed(&tree, 1);
+	root = build(&tree, 3);
+	zz_tree_token_nodes(&tree, TOK_NUM, &count);
+	assert(count == 0);
+	zz_tree_sync(&tree);
+	check(&tree, root);
+	zz_tree_destroy(&tree);
+
+	exit(EXIT_SUCCESS);
+}
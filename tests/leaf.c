@@ -0,0 +1,112 @@
+/*
+ * Test for leaf nodes
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_ADD = "add";
+static const char *TOK_NUM = "num";
+static const char *TOK_ID = "id";
+
+static struct zz_node *build(struct zz_tree *tree, int width)
+{
+	struct zz_node *add;
+	int i;
+
+	add = zz_node(tree, TOK_ADD, zz_null);
+	for (i = 0; i < width; ++i) {
+		zz_append_child(add, zz_leaf(tree, TOK_NUM, zz_int(i)));
+		zz_append_child(add, zz_leaf(tree, TOK_ID, zz_string("x")));
+	}
+	return add;
+}
+
+static int count(struct zz_node *node)
+{
+	struct zz_node *iter;
+	int ret = 1;
+
+	zz_foreach_child(iter, node)
+		ret += count(iter);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree, copy;
+	struct zz_tree_stats stats;
+	struct zz_node *root, *add, *leaf, *iter;
+	int i;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	assert(ZZ_LEAF_SIZE < sizeof(struct zz_node));
+
+	/* Leaves have no children */
+	leaf = zz_leaf(&tree, TOK_NUM, zz_int(1));
+	assert(zz_is_leaf(leaf));
+	assert(zz_first_child(leaf) == NULL);
+	assert(zz_last_child(leaf) == NULL);
+	zz_foreach_child(iter, leaf)
+		assert(0);
+	assert(zz_tree_sizeof(&tree, leaf) == ZZ_LEAF_SIZE);
+
+	root = zz_node(&tree, TOK_ADD, zz_null);
+	assert(!zz_is_leaf(root));
+	assert(zz_tree_sizeof(&tree, root) == sizeof(struct zz_node));
+	zz_append_child(root, leaf);
+	assert(zz_first_child(root) == leaf);
+
+	/* Leaves are accounted and recycled with their own size */
+	add = build(&tree, 10);
+	zz_append_child(root, add);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 23);
+	assert(stats.bytes_used == 2 * sizeof(struct zz_node) +
+			21 * ZZ_LEAF_SIZE);
+	zz_done(&tree, add);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.recycled == 21);
+	for (i = 0; i < 3; ++i) {
+		add = build(&tree, 10);
+		zz_append_child(root, add);
+		zz_foreach_child(iter, add)
+			assert(zz_is_leaf(iter));
+		zz_done(&tree, add);
+	}
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 2 && stats.recycled == 21);
+
+	/* Copies keep leaves as leaves */
+	for (i = 0; i < 100; ++i)
+		zz_append_child(root, build(&tree, 20));
+	zz_tree_init(&copy, sizeof(struct zz_node));
+	add = zz_copy_recursive(&copy, root);
+	assert(count(add) == count(root));
+	assert(zz_is_leaf(zz_first_child(add)));
+	assert(zz_is_leaf(zz_last_child(zz_last_child(add))));
+	assert(strcmp(zz_get_string(zz_last_child(zz_last_child(add))),
+				"x") == 0);
+	zz_tree_destroy(&copy);
+
+	zz_tree_init(&copy, sizeof(struct zz_node));
+	zz_copy_recursive_parallel(&copy, root, 4);
+	zz_tree_stats(&copy, &stats);
+	assert(stats.nodes == 2 + 100 * 41);
+	assert(stats.bytes_used == (1 + 100) * sizeof(struct zz_node) +
+			(1 + 100 * 40) * ZZ_LEAF_SIZE);
+	zz_tree_destroy_parallel(&copy, 4);
+	zz_tree_destroy(&tree);
+
+	/* Concurrent trees create leaves too */
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_set_concurrent(&tree, 1);
+	zz_leaf(&tree, TOK_NUM, zz_null);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.bytes_used == ZZ_LEAF_SIZE);
+	zz_tree_destroy(&tree);
+
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,142 @@
+/*
+ * Test for parsing literals
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static struct zz_data parse_int(const char *str)
+{
+	struct zz_data data;
+
+	assert(zz_parse_int(str, strlen(str), &data) == 0);
+	return data;
+}
+
+static int invalid_int(const char *str)
+{
+	struct zz_data data;
+
+	return zz_parse_int(str, strlen(str), &data) < 0;
+}
+
+static void check_double(const char *str)
+{
+	struct zz_data data;
+	double expected;
+
+	assert(zz_parse_double(str, strlen(str), &data) == 0);
+	expected = strtod(str, NULL);
+	if (expected != expected)
+		assert(zz_to_double(data) != zz_to_double(data));
+	else
+		assert(memcmp(&expected, &(double){ zz_to_double(data) },
+					sizeof(expected)) == 0);
+}
+
+static int invalid_double(const char *str)
+{
+	struct zz_data data;
+
+	return zz_parse_double(str, strlen(str), &data) < 0;
+}
+
+static void test_int(void)
+{
+	struct zz_data data;
+
+	assert(zz_to_int(parse_int("0")) == 0);
+	assert(zz_to_int(parse_int("42")) == 42);
+	assert(zz_to_int(parse_int("-42")) == -42);
+	assert(zz_to_int(parse_int("+42")) == 42);
+	assert(zz_to_int(parse_int("0x2a")) == 42);
+	assert(zz_to_int(parse_int("0X2A")) == 42);
+	assert(zz_to_int(parse_int("052")) == 42);
+	assert(zz_to_int(parse_int("0b101010")) == 42);
+	assert(zz_to_int(parse_int("1234567890")) == 1234567890);
+	assert(zz_to_int(parse_int("2147483647")) == INT_MAX);
+	assert(zz_to_int(parse_int("-2147483648")) == INT_MIN);
+	assert(zz_to_uint(parse_int("4294967295")) == UINT_MAX);
+#ifndef ZZ_COMPACT_DATA
+	assert(zz_to_int64(parse_int("4294967296")) == 4294967296LL);
+	assert(zz_to_int64(parse_int("-9223372036854775808")) == INT64_MIN);
+	assert(zz_to_uint64(parse_int("18446744073709551615")) == UINT64_MAX);
+	assert(zz_to_uint64(parse_int("0xffffffffffffffff")) == UINT64_MAX);
+	assert(zz_to_int64(parse_int("12345678901234567")) ==
+			12345678901234567LL);
+	assert(invalid_int("-9223372036854775809"));
+#else
+	assert(invalid_int("4294967296"));
+#endif
+	assert(invalid_int("18446744073709551616"));
+	assert(invalid_int("99999999999999999999"));
+	assert(invalid_int(""));
+	assert(invalid_int("-"));
+	assert(invalid_int("0x"));
+	assert(invalid_int("08"));
+	assert(invalid_int("0b2"));
+	assert(invalid_int("12a"));
+	assert(invalid_int(" 12"));
+	assert(invalid_int("1234567a9"));
+
+	/* Only the given length is read */
+	assert(zz_parse_int("12345", 3, &data) == 0);
+	assert(zz_to_int(data) == 123);
+}
+
+static void test_double(void)
+{
+	static const char *literals[] = {
+		"0", "-0", "1", "0.5", ".5", "5.", "3.14159", "1e10", "1E-10",
+		"+2.5e+3", "123456789012345678", "0.1", "0.3", "1e22", "1e23",
+		"9007199254740993", "2.2250738585072011e-308",
+		"2.2250738585072014e-308", "4.9e-324", "1.7976931348623157e308",
+		"1e309", "1e-400", "0.000000000000000000000000000001",
+		"1234567890.0987654321", "7.0e-10", "00000000123.456",
+		"0x1p3", "inf", "-Infinity", "nan",
+		"3.141592653589793238462643383279502884197169399375105820974944",
+	};
+	static const double scales[] = {
+		1e-300, 1e-20, 1e-5, 1, 1e5, 1e15, 1e20, 1e300
+	};
+	struct zz_data data;
+	char buf[64];
+	size_t i;
+	double d;
+
+	for (i = 0; i < sizeof(literals) / sizeof(literals[0]); ++i)
+		check_double(literals[i]);
+
+	/* Round trips, and random digit strings */
+	srand(42);
+	for (i = 0; i < 100000; ++i) {
+		d = (double)rand() / RAND_MAX * scales[i % 8];
+		snprintf(buf, sizeof(buf), "%.*g", (int)(i % 17) + 1, d);
+		check_double(buf);
+		snprintf(buf, sizeof(buf), "%.17g", d);
+		check_double(buf);
+	}
+
+	assert(invalid_double(""));
+	assert(invalid_double("."));
+	assert(invalid_double("-"));
+	assert(invalid_double("e5"));
+	assert(invalid_double("1e"));
+	assert(invalid_double("1.5x"));
+	assert(invalid_double(" 1.5"));
+	assert(invalid_double("1,5"));
+
+	assert(zz_parse_double("2.5e3", 3, &data) == 0);
+	assert(zz_to_double(data) == 2.5);
+}
+
+int main(int argc, char *argv[])
+{
+	test_int();
+	test_double();
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,120 @@
+/*
+ * Test for pre/post-order numbering and ancestor queries
+ */
+
+#include <assert.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_FOO = "foo";
+
+#define NUM_NODES 2000
+
+static struct zz_node *nodes[NUM_NODES];
+static struct zz_node *parents[NUM_NODES];
+
+/* Reference ancestor test, climbing the parents */
+static int is_ancestor(struct zz_node *a, struct zz_node *b)
+{
+	for (; b != NULL; b = parents[b->id])
+		if (a == b)
+			return 1;
+	return 0;
+}
+
+static unsigned int depth(struct zz_node *n)
+{
+	unsigned int ret = 0;
+
+	for (; parents[n->id] != NULL; n = parents[n->id])
+		++ret;
+	return ret;
+}
+
+static struct zz_node *lca(struct zz_node *a, struct zz_node *b)
+{
+	for (; !is_ancestor(a, b); a = parents[a->id])
+		continue;
+	return a;
+}
+
+static void check(struct zz_order *order, int num_nodes)
+{
+	struct zz_node *a, *b;
+	int i, j;
+
+	for (i = 0; i < num_nodes; ++i) {
+		a = nodes[i];
+		assert(zz_parent(order, a) == parents[a->id]);
+		assert(zz_depth(order, a) == depth(a));
+		for (j = i % 7; j < num_nodes; j += 7) {
+			b = nodes[j];
+			assert(zz_is_ancestor(order, a, b) == is_ancestor(a, b));
+			assert(zz_lca(order, a, b) == lca(a, b));
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree;
+	struct zz_order order;
+	struct zz_node *leaf, *deep;
+	unsigned int seed = 1;
+	int i;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	for (i = 0; i < NUM_NODES; ++i) {
+		nodes[i] = zz_node(&tree, TOK_FOO, zz_int(i));
+		assert(nodes[i]->id == i);
+		if (i > 0) {
+			seed = seed * 1103515245 + 12345;
+			parents[i] = nodes[(seed >> 8) % i];
+			zz_append_child(parents[i], nodes[i]);
+		}
+	}
+
+	/* Updating a numbering that was never built does nothing */
+	zz_order_init(&order, NULL);
+	zz_order_update(&order);
+	assert(!order.valid && order.size == 0);
+	zz_order_build(&order, nodes[0]);
+	assert(order.size == NUM_NODES);
+	assert(zz_order_get(&order, nodes[0])->pre == 1);
+	assert(zz_order_get(&order, nodes[0])->post == NUM_NODES);
+	check(&order, NUM_NODES);
+
+	/* Nodes outside the subtree have no position */
+	leaf = zz_node(&tree, TOK_FOO, zz_null);
+	assert(zz_order_get(&order, leaf) == NULL);
+
+	/* Edits invalidate the numbering until it is updated */
+	for (i = NUM_NODES / 2; i < NUM_NODES; i += 100) {
+		zz_unlink_child(nodes[i]);
+		zz_prepend_child(nodes[0], nodes[i]);
+		parents[i] = nodes[0];
+	}
+	zz_order_invalidate(&order);
+	assert(!order.valid);
+	zz_order_update(&order);
+	check(&order, NUM_NODES);
+
+	/* Deep chains don't need a stack */
+	deep = nodes[NUM_NODES - 1];
+	for (i = 0; i < 100000; ++i) {
+		leaf = zz_node(&tree, TOK_FOO, zz_null);
+		zz_append_child(deep, leaf);
+		deep = leaf;
+	}
+	zz_order_invalidate(&order);
+	zz_order_update(&order);
+	assert(order.size == NUM_NODES + 100000);
+	assert(zz_depth(&order, deep) == depth(nodes[NUM_NODES - 1]) + 100000);
+	assert(zz_is_ancestor(&order, nodes[0], deep));
+	assert(zz_lca(&order, nodes[NUM_NODES - 1], deep) ==
+			nodes[NUM_NODES - 1]);
+
+	zz_order_destroy(&order);
+	zz_tree_destroy(&tree);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,114 @@
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+
+struct sum {
+	long nodes;
+	long total;
+};
+
+static struct zz_node *build(struct zz_tree *tree, int depth, int width, int *next)
+{
+	struct zz_node *n;
+	int i;
+
+	n = zz_node(tree, depth ? TOK_FOO : TOK_BAR, zz_int((*next)++));
+	if (*next % 3 == 0)
+		zz_append_child(n, zz_node(tree, TOK_BAR, zz_string("leaf")));
+	for (i = 0; depth > 0 && i < width; ++i)
+		zz_append_child(n, build(tree, depth - 1, width, next));
+	return n;
+}
+
+static void count(struct zz_node *n, void *data)
+{
+	if (zz_is_int(n))
+		__sync_fetch_and_add((long *)data, zz_get_int(n));
+}
+
+static void accumulate(struct zz_node *n, void *acc, void *data)
+{
+	struct sum *s = acc;
+	++s->nodes;
+	if (zz_is_int(n))
+		s->total += zz_get_int(n);
+}
+
+static char *print(struct zz_node *n)
+{
+	char *buf;
+	size_t size;
+	FILE *f;
+
+	f = open_memstream(&buf, &size);
+	zz_print(n, f);
+	fclose(f);
+	return buf;
+}
+
+static void merge(void *dst, const void *src, void *data)
+{
+	struct sum *d = dst;
+	const struct sum *s = src;
+	d->nodes += s->nodes;
+	d->total += s->total;
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree, other;
+	struct zz_node *wide, *copy, *deep, *spine, *n;
+	struct sum s;
+	long total;
+	int next, i;
+	size_t threads, num_nodes;
+	char *expected, *actual;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+
+	next = 0;
+	wide = build(&tree, 3, 30, &next);
+	for (threads = 1; threads <= 8; threads *= 2) {
+		total = 0;
+		zz_parallel_foreach(wide, threads, count, &total);
+		assert(total == (long)next * (next - 1) / 2);
+
+		s = (struct sum){ 0, 0 };
+		zz_parallel_reduce(wide, threads, sizeof(s), &s, accumulate,
+				merge, NULL);
+		num_nodes = s.nodes;
+		assert(s.total == (long)next * (next - 1) / 2);
+	}
+	assert(num_nodes == next + next / 3);
+
+	expected = print(wide);
+	for (threads = 1; threads <= 8; threads *= 2) {
+		zz_tree_init(&other, sizeof(struct zz_node));
+		copy = zz_copy_recursive_parallel(&other, wide, threads);
+		actual = print(copy);
+		assert(strcmp(expected, actual) == 0);
+		free(actual);
+		zz_tree_destroy_parallel(&other, threads);
+	}
+	free(expected);
+
+	deep = spine = zz_node(&tree, TOK_FOO, zz_int(0));
+	for (i = 1; i < 100000; ++i) {
+		zz_append_child(spine, zz_node(&tree, TOK_BAR, zz_int(0)));
+		n = zz_node(&tree, TOK_FOO, zz_int(1));
+		zz_append_child(spine, n);
+		spine = n;
+	}
+	s = (struct sum){ 0, 0 };
+	zz_parallel_reduce(deep, 4, sizeof(s), &s, accumulate, merge, NULL);
+	assert(s.nodes == 2 * 100000 - 1);
+	assert(s.total == 100000 - 1);
+
+	zz_tree_destroy(&tree);
+	exit(EXIT_SUCCESS);
+}
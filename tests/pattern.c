@@ -0,0 +1,140 @@
+/*
+ * Test for the pattern matcher
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+#define DEPTH 1000000
+
+static const char *TOK_ADD = "add";
+static const char *TOK_MUL = "mul";
+static const char *TOK_NUM = "num";
+static const char *TOK_ID = "id";
+
+static const char *const *TOKENS[] = { &TOK_ADD, &TOK_MUL, &TOK_NUM, &TOK_ID };
+
+static const char *const PATTERNS[] = {
+	"[mul [num 0] _]",
+	"[add x x]",
+	"[add [num 0] x]",
+	"[_ [id \"a\"] _]",
+	"[mul [num 1.5] x]",
+	"x",
+};
+
+static struct zz_node *op(struct zz_tree *tree, const char *token,
+		struct zz_node *a, struct zz_node *b)
+{
+	struct zz_node *n = zz_node(tree, token, zz_null);
+
+	zz_append_child(n, a);
+	zz_append_child(n, b);
+	return n;
+}
+
+/* Left-leaning sum 1 + 1 + ... + 1 of depth ``depth`` */
+static struct zz_node *chain(struct zz_tree *tree, size_t depth)
+{
+	struct zz_node *root;
+	size_t i;
+
+	root = zz_leaf(tree, TOK_NUM, zz_int(1));
+	for (i = 0; i < depth; ++i)
+		root = op(tree, TOK_ADD, root, zz_leaf(tree, TOK_NUM, zz_int(1)));
+	return root;
+}
+
+static int print_match(struct zz_node *node, const struct zz_match *m,
+		void *data)
+{
+	unsigned int i;
+
+	if (m->pattern == 5)
+		return 0;
+	printf("%s:", PATTERNS[m->pattern]);
+	for (i = 0; i < m->num_bindings; ++i) {
+		printf(" ");
+		zz_print(m->bindings[i], stdout);
+	}
+	printf("\n");
+	return 0;
+}
+
+static int count_match(struct zz_node *node, const struct zz_match *m,
+		void *data)
+{
+	++((size_t *)data)[m->pattern];
+	return 0;
+}
+
+static int stop(struct zz_node *node, const struct zz_match *m, void *data)
+{
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *tokens[4];
+	struct zz_patterns set;
+	struct zz_tree tree;
+	struct zz_node *root;
+	size_t counts[6] = { 0 };
+	size_t deep[6] = { 0 };
+	size_t i;
+
+	for (i = 0; i < 4; ++i)
+		tokens[i] = *TOKENS[i];
+	zz_patterns_init(&set, tokens, 4);
+	for (i = 0; i < sizeof(PATTERNS) / sizeof(PATTERNS[0]); ++i)
+		assert(zz_pattern_add(&set, PATTERNS[i]) == i);
+	assert(zz_pattern_var(&set, 1, "x") == 0);
+	assert(zz_pattern_var(&set, 1, "y") == -1);
+
+	/* Syntax errors and unknown tokens */
+	assert(zz_pattern_add(&set, "[add x") == -1);
+	assert(zz_pattern_add(&set, "[sub x y]") == -1);
+	assert(zz_pattern_add(&set, "[num \"unterminated]") == -1);
+	assert(zz_pattern_add(&set, "[add x] y") == -1);
+	assert(set.num_patterns == 6);
+
+	/* (0 * a) + (0 * a) + (1.5 * (a + 0)) + (0 + b) */
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	root = op(&tree, TOK_ADD,
+		op(&tree, TOK_ADD,
+			op(&tree, TOK_MUL, zz_node(&tree, TOK_NUM, zz_int(0)),
+				zz_node(&tree, TOK_ID, zz_string("a"))),
+			op(&tree, TOK_MUL, zz_node(&tree, TOK_NUM, zz_uint(0)),
+				zz_node(&tree, TOK_ID, zz_string("a")))),
+		op(&tree, TOK_ADD,
+			op(&tree, TOK_MUL,
+				zz_node(&tree, TOK_NUM, zz_double(1.5)),
+				op(&tree, TOK_ADD,
+					zz_node(&tree, TOK_ID, zz_string("a")),
+					zz_node(&tree, TOK_NUM, zz_int(0)))),
+			op(&tree, TOK_ADD, zz_node(&tree, TOK_NUM, zz_int(0)),
+				zz_node(&tree, TOK_ID, zz_string("b")))));
+	setvbuf(stdout, NULL, _IONBF, 0);
+	zz_match_tree(&set, root, print_match, NULL);
+
+	assert(zz_match_tree(&set, root, count_match, counts) == 17 + 6);
+	assert(counts[0] == 2 && counts[1] == 1 && counts[2] == 1);
+	assert(counts[3] == 1 && counts[4] == 1 && counts[5] == 17);
+	assert(zz_match(&set, root, count_match, counts) == 1);
+	assert(zz_match_tree(&set, root, stop, NULL) == 1);
+
+	/* Deep trees, and deep subtrees bound to the same variable */
+	root = op(&tree, TOK_ADD, chain(&tree, DEPTH), chain(&tree, DEPTH));
+	assert(zz_match_tree(&set, root, count_match, deep) ==
+			4 * DEPTH + 3 + 3);
+	assert(deep[1] == 3 && deep[5] == 4 * DEPTH + 3);
+	zz_append_child(zz_last_child(root), zz_leaf(&tree, TOK_NUM, zz_int(1)));
+	assert(zz_match(&set, root, count_match, deep) == 1);
+
+	zz_tree_destroy(&tree);
+	zz_patterns_destroy(&set);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,62 @@
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_ADD = "add";
+static const char *TOK_NUM = "num";
+
+static void visit(struct zz_node *node, void *data)
+{
+	long *sum = data;
+	struct zz_node *iter;
+	struct zz_data str;
+
+	assert(node->token == TOK_ADD);
+	str = zz_string("visited");
+	assert(strcmp(zz_to_string(str), "visited") == 0);
+	zz_data_destroy(str);
+	zz_foreach_child(iter, node)
+		__sync_fetch_and_add(sum, zz_get_int(iter));
+}
+
+static size_t count_nodes(struct zz_list *list)
+{
+	struct zz_list *iter;
+	size_t count = 0;
+
+	zz_list_foreach(iter, list)
+		++count;
+	return count;
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree;
+	struct zz_pipeline pipeline;
+	struct zz_node *root, *line;
+	long sum = 0;
+	int i;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_pipeline_init(&pipeline, &tree, 4, 8, visit, &sum);
+
+	root = zz_node(&tree, TOK_ADD, zz_null);
+	for (i = 0; i < 10000; ++i) {
+		line = zz_node(&tree, TOK_ADD, zz_string("line"));
+		zz_append_child(line, zz_node(&tree, TOK_NUM, zz_int(i)));
+		zz_append_child(line, zz_node(&tree, TOK_NUM, zz_int(1)));
+		zz_append_child(root, line);
+		zz_pipeline_submit(&pipeline, line);
+	}
+	zz_pipeline_destroy(&pipeline);
+
+	assert(sum == 10000L * 9999 / 2 + 10000);
+	assert(zz_first_child(root) == NULL);
+	assert(count_nodes(&tree.nodes) == 1);
+	assert(count_nodes(&tree.recycled) <= 3 * (8 + 4 + 1));
+
+	zz_tree_destroy(&tree);
+	exit(EXIT_SUCCESS);
+}
@@ -30,6 +30,12 @@ int main(int argc, char *argv[])
 	zz_append_child(root, node);
 	node = zz_node(&tree, TOK_BAZ, zz_pointer(NULL));
 	zz_append_child(root, node);
+#ifndef ZZ_COMPACT_DATA
+	node = zz_node(&tree, TOK_FOO, zz_slice("3141", 3));
+#else
+	node = zz_node(&tree, TOK_FOO, zz_string("314"));
+#endif
+	zz_append_child(root, node);
 
 	zz_print(root, stdout);
 	printf("\n");
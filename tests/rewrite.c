@@ -0,0 +1,159 @@
+/*
+ * Test for the rewrite engine
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_ADD = "add";
+static const char *TOK_SUB = "sub";
+static const char *TOK_MUL = "mul";
+static const char *TOK_NUM = "num";
+static const char *TOK_ID = "id";
+
+static struct zz_node *op(struct zz_tree *tree, const char *token,
+		struct zz_node *a, struct zz_node *b)
+{
+	struct zz_node *n = zz_node(tree, token, zz_null);
+
+	zz_append_child(n, a);
+	zz_append_child(n, b);
+	return n;
+}
+
+static struct zz_node *num(struct zz_tree *tree, int value)
+{
+	return zz_leaf(tree, TOK_NUM, zz_int(value));
+}
+
+static struct zz_node *id(struct zz_tree *tree, const char *name)
+{
+	return zz_leaf(tree, TOK_ID, zz_string(name));
+}
+
+/* [add [num] [num]] and [mul [num] [num]] */
+static struct zz_node *fold(struct zz_tree *tree, struct zz_node *node,
+		const struct zz_match *match, void *data)
+{
+	int a = zz_get_int(zz_first_child(node));
+	int b = zz_get_int(zz_last_child(node));
+
+	return num(tree, node->token == TOK_ADD ? a + b : a * b);
+}
+
+/* [add x [num 0]] and [mul x [num 1]] */
+static struct zz_node *identity(struct zz_tree *tree, struct zz_node *node,
+		const struct zz_match *match, void *data)
+{
+	return match->bindings[0];
+}
+
+/* [mul _ [num 0]] and [sub x x] */
+static struct zz_node *zero(struct zz_tree *tree, struct zz_node *node,
+		const struct zz_match *match, void *data)
+{
+	return num(tree, 0);
+}
+
+/* [add [num] x]: move the constant to the right, in place */
+static struct zz_node *swap(struct zz_tree *tree, struct zz_node *node,
+		const struct zz_match *match, void *data)
+{
+	zz_append_child(node, zz_take(zz_first_child(node)));
+	return node;
+}
+
+/* [sub x [num]]: x + -n, built from the bindings */
+static struct zz_node *negate(struct zz_tree *tree, struct zz_node *node,
+		const struct zz_match *match, void *data)
+{
+	int n = zz_get_int(zz_last_child(node));
+
+	return op(tree, TOK_ADD, zz_take(match->bindings[0]), num(tree, -n));
+}
+
+/* [id]: only rewrite identifiers that are in the table */
+static struct zz_node *lookup(struct zz_tree *tree, struct zz_node *node,
+		const struct zz_match *match, void *data)
+{
+	if (strcmp(zz_get_string(node), "two") != 0)
+		return NULL;
+	return num(tree, 2);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *tokens[] = { TOK_ADD, TOK_SUB, TOK_MUL, TOK_NUM, TOK_ID };
+	struct zz_rewriter rw;
+	struct zz_tree tree;
+	struct zz_tree_stats stats;
+	struct zz_node *root, *parent;
+	size_t before;
+	int i;
+
+	zz_rewriter_init(&rw, tokens, 5);
+	assert(zz_rewrite_rule(&rw, "[add [num] [num]]", fold, NULL) == 0);
+	assert(zz_rewrite_rule(&rw, "[mul [num] [num]]", fold, NULL) == 1);
+	assert(zz_rewrite_rule(&rw, "[add x [num 0]]", identity, NULL) == 2);
+	assert(zz_rewrite_rule(&rw, "[mul x [num 1]]", identity, NULL) == 3);
+	assert(zz_rewrite_rule(&rw, "[mul _ [num 0]]", zero, NULL) == 4);
+	assert(zz_rewrite_rule(&rw, "[sub x x]", zero, NULL) == 5);
+	assert(zz_rewrite_rule(&rw, "[add [num] x]", swap, NULL) == 6);
+	assert(zz_rewrite_rule(&rw, "[sub x [num]]", negate, NULL) == 7);
+	assert(zz_rewrite_rule(&rw, "[id]", lookup, NULL) == 8);
+	assert(zz_rewrite_rule(&rw, "[add x", swap, NULL) == -1);
+
+	setvbuf(stdout, NULL, _IONBF, 0);
+	zz_tree_init(&tree, sizeof(struct zz_node));
+
+	/* ((1 + 2) * a) - (3 * a) + (2 + (b * (two - 1))) */
+	parent = zz_node(&tree, TOK_SUB, zz_null);
+	root = op(&tree, TOK_ADD,
+		op(&tree, TOK_SUB,
+			op(&tree, TOK_MUL, op(&tree, TOK_ADD, num(&tree, 1),
+					num(&tree, 2)), id(&tree, "a")),
+			op(&tree, TOK_MUL, num(&tree, 3), id(&tree, "a"))),
+		op(&tree, TOK_ADD, num(&tree, 2),
+			op(&tree, TOK_MUL, id(&tree, "b"),
+				op(&tree, TOK_SUB, id(&tree, "two"),
+					num(&tree, 1)))));
+	zz_append_child(parent, root);
+	zz_append_child(parent, id(&tree, "c"));
+	zz_print(parent, stdout);
+	printf("\n");
+	zz_tree_stats(&tree, &stats);
+	before = stats.nodes;
+	root = zz_rewrite(&rw, &tree, root);
+	zz_print(parent, stdout);
+	printf("\n");
+	assert(zz_first_child(parent) == root);
+	printf("%zu rewrites\n", rw.num_rewrites);
+
+	/* Replaced nodes are recycled */
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes < before);
+	assert(stats.recycled > 0);
+
+	/* Rewriting again does nothing */
+	rw.num_rewrites = 0;
+	assert(zz_rewrite(&rw, &tree, parent) == parent);
+	assert(rw.num_rewrites == 0);
+
+	/* A long chain folds in one pass: 1 + 1 + ... + 1 */
+	root = num(&tree, 1);
+	for (i = 1; i < 10000; ++i)
+		root = op(&tree, TOK_ADD, num(&tree, 1), root);
+	root = zz_rewrite(&rw, &tree, root);
+	assert(root->token == TOK_NUM && zz_get_int(root) == 10000);
+	zz_recycle(&tree, root);
+	zz_recycle(&tree, parent);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 0);
+
+	zz_tree_destroy(&tree);
+	zz_rewriter_destroy(&rw);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,77 @@
+/*
+ * Test for source spans
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_ADD = "add";
+static const char *TOK_NUM = "num";
+
+static const char SOURCE[] =
+"x = 1 +\n"
+"    22;\n"
+"\n"
+"y = oops;\n";
+
+int main(int argc, char *argv[])
+{
+	struct zz_sources sources;
+	struct zz_location loc;
+	struct zz_tree tree, copy;
+	struct zz_node *add, *num;
+	uint32_t base, other;
+
+	zz_sources_init(&sources);
+	base = zz_source_add(&sources, "calc.txt", SOURCE, strlen(SOURCE));
+	other = zz_source_add_file(&sources, "error.c");
+	assert(base == 1);
+	assert(other > base + strlen(SOURCE));
+	assert(zz_source_add_file(&sources, "does-not-exist") == 0);
+
+	assert(zz_source_location(&sources, base, &loc));
+	assert(strcmp(loc.file, "calc.txt") == 0);
+	assert(loc.line == 1 && loc.column == 1);
+	assert(zz_source_location(&sources, base + 12, &loc));
+	assert(loc.line == 2 && loc.column == 5);
+	assert(zz_source_location(&sources, base + strlen(SOURCE), &loc));
+	assert(loc.line == 5 && loc.column == 1);
+	assert(zz_source_location(&sources, other + 1, &loc));
+	assert(strcmp(loc.file, "error.c") == 0);
+	assert(loc.line == 1 && loc.column == 2);
+	assert(!zz_source_location(&sources, 0, &loc));
+	assert(loc.file == NULL);
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	add = zz_node(&tree, TOK_ADD, zz_null);
+	assert(add->span.begin == 0 && add->span.end == 0);
+	num = zz_node(&tree, TOK_NUM, zz_int(1));
+	zz_set_span(num, zz_span(base + 4, base + 5));
+	zz_append_child(add, num);
+	zz_extend_span(add, num->span);
+	num = zz_node(&tree, TOK_NUM, zz_int(22));
+	zz_set_span(num, zz_span(base + 12, base + 14));
+	zz_append_child(add, num);
+	zz_extend_span(add, num->span);
+	assert(add->span.begin == base + 4 && add->span.end == base + 14);
+
+	zz_tree_init(&copy, sizeof(struct zz_node));
+	add = zz_copy_recursive(&copy, add);
+	zz_tree_destroy(&tree);
+	assert(zz_last_child(add)->span.end == base + 14);
+
+	zz_error_node(&sources, "22 is not a number", zz_last_child(add));
+	zz_error_node(&sources, "sum of nothing", add);
+	zz_error_span(&sources, "undefined", zz_span(base + 21, base + 25));
+	zz_error_span(&sources, "missing newline",
+			zz_span(base + strlen(SOURCE), base + strlen(SOURCE)));
+	zz_error_span(&sources, "prontf is not a function",
+			zz_span(other + 82, other + 88));
+	zz_error_span(&sources, "nowhere", zz_span(0, 0));
+
+	zz_tree_destroy(&copy);
+	zz_sources_destroy(&sources);
+	exit(EXIT_SUCCESS);
+}
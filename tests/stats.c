@@ -0,0 +1,76 @@
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+#include "../src/dict.h"
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+
+static void check_token(const char *token, size_t count, void *data)
+{
+	int *seen = data;
+
+	if (token == TOK_FOO) {
+		assert(count == 1);
+		seen[0] = 1;
+	} else {
+		assert(token == TOK_BAR);
+		assert(count == 100);
+		seen[1] = 1;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree;
+	struct zz_tree_stats stats;
+	struct zz_dict_stats strings, base;
+	struct zz_node *root, *n;
+	char buf[16];
+	int i, seen[2] = { 0, 0 };
+
+	zz_string_stats(&base);
+	zz_tree_init(&tree, sizeof(struct zz_node) + 16);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 0);
+	assert(stats.bytes_allocated == 0);
+
+	root = zz_node(&tree, TOK_FOO, zz_null);
+	for (i = 0; i < 100; ++i) {
+		snprintf(buf, sizeof(buf), "%d", i % 10);
+		zz_append_child(root, zz_node(&tree, TOK_BAR, zz_string(buf)));
+	}
+
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 101);
+	assert(stats.recycled == 0);
+	assert(stats.bytes_used == 101 * tree.node_size);
+	assert(stats.bytes_allocated == stats.bytes_used);
+
+	zz_tree_token_stats(&tree, check_token, seen);
+	assert(seen[0] && seen[1]);
+
+	zz_string_stats(&strings);
+	assert(strings.strings == base.strings + 10);
+	assert(strings.references == base.references + 100);
+	assert(strings.bytes >= base.bytes + 10 * (sizeof(struct zz_dict) + 2));
+	assert(strings.depth >= 4);
+
+	for (i = 0; i < 50; ++i) {
+		n = zz_first_child(root);
+		zz_unlink_child(n);
+		zz_recycle(&tree, n);
+	}
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 51);
+	assert(stats.recycled == 50);
+	assert(stats.bytes_allocated == 101 * tree.node_size);
+
+	zz_string_stats(&strings);
+	assert(strings.references == base.references + 50);
+
+	zz_tree_destroy(&tree);
+	exit(EXIT_SUCCESS);
+}
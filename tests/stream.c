@@ -0,0 +1,60 @@
+
+#include <assert.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_INPUT = "input";
+static const char *TOK_NUM = "num";
+static const char *TOK_ADD = "add";
+
+static void print_line(struct zz_node *node, void *data)
+{
+	size_t *count = data;
+
+	zz_print(node, stdout);
+	printf("\n");
+	++*count;
+}
+
+static size_t count_nodes(struct zz_list *list)
+{
+	struct zz_list *iter;
+	size_t count = 0;
+
+	zz_list_foreach(iter, list)
+		++count;
+	return count;
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree;
+	struct zz_node *root, *line, *first;
+	size_t count = 0;
+	int i;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_set_consumer(&tree, print_line, &count);
+
+	root = zz_node(&tree, TOK_INPUT, zz_null);
+	first = NULL;
+	for (i = 0; i < 1000; ++i) {
+		line = zz_node(&tree, TOK_ADD, zz_string("sum"));
+		zz_append_child(line, zz_node(&tree, TOK_NUM, zz_int(i)));
+		zz_append_child(line, zz_node(&tree, TOK_NUM, zz_int(-i)));
+		zz_append_child(root, line);
+		if (first == NULL)
+			first = line;
+		else
+			assert(count_nodes(&tree.nodes) == 4);
+		if (i == 3)
+			zz_tree_set_consumer(&tree, NULL, NULL);
+		zz_done(&tree, line);
+	}
+	assert(count == 3);
+	assert(zz_first_child(root) == NULL);
+	assert(count_nodes(&tree.recycled) == 3);
+
+	zz_tree_destroy(&tree);
+	exit(EXIT_SUCCESS);
+}
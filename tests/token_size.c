@@ -0,0 +1,131 @@
+/*
+ * Test for nodes with a size per token
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_FUNC = "func";
+static const char *TOK_CALL = "call";
+static const char *TOK_NUM = "num";
+
+struct func_node {
+	struct zz_node node;
+	char scope[200];
+};
+
+struct call_node {
+	struct zz_node node;
+	void *target;
+};
+
+static struct zz_node *build(struct zz_tree *tree, int width)
+{
+	struct zz_node *func, *call;
+	int i;
+
+	func = zz_node(tree, TOK_FUNC, zz_null);
+	memset(((struct func_node *)func)->scope, 'x', 200);
+	for (i = 0; i < width; ++i) {
+		call = zz_node(tree, TOK_CALL, zz_int(i));
+		((struct call_node *)call)->target = func;
+		zz_append_child(call, zz_node(tree, TOK_NUM, zz_int(i)));
+		zz_append_child(func, call);
+	}
+	return func;
+}
+
+static size_t tree_bytes(int width)
+{
+	return sizeof(struct func_node) +
+		width * (sizeof(struct call_node) + sizeof(struct zz_node));
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree, copy;
+	struct zz_tree_stats stats;
+	struct zz_node *root, *func, *iter;
+	int i;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_set_token_size(&tree, TOK_FUNC, sizeof(struct func_node));
+	zz_tree_set_token_size(&tree, TOK_CALL, sizeof(struct call_node));
+	assert(zz_tree_node_size(&tree, TOK_FUNC) == sizeof(struct func_node));
+	assert(zz_tree_node_size(&tree, TOK_CALL) == sizeof(struct call_node));
+	assert(zz_tree_node_size(&tree, TOK_NUM) == sizeof(struct zz_node));
+
+	root = zz_node(&tree, TOK_NUM, zz_null);
+	func = build(&tree, 10);
+	zz_append_child(root, func);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 22);
+	assert(stats.bytes_used == sizeof(struct zz_node) + tree_bytes(10));
+
+	/* Recycled nodes are only reused for nodes of the same size */
+	zz_done(&tree, func);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.recycled == 21);
+	assert(stats.bytes_allocated - stats.bytes_used == tree_bytes(10));
+	for (i = 0; i < 3; ++i) {
+		func = build(&tree, 10);
+		zz_append_child(root, func);
+		zz_foreach_child(iter, func)
+			assert(((struct call_node *)iter)->target == func);
+		zz_done(&tree, func);
+	}
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 1 && stats.recycled == 21);
+
+	/* Copies take the sizes of the destination tree */
+	for (i = 0; i < 100; ++i)
+		zz_append_child(root, build(&tree, 30));
+	zz_tree_init(&copy, sizeof(struct zz_node));
+	zz_tree_set_token_size(&copy, TOK_FUNC, sizeof(struct func_node));
+	zz_tree_set_token_size(&copy, TOK_CALL, sizeof(struct call_node));
+	zz_copy_recursive_parallel(&copy, root, 4);
+	zz_tree_stats(&copy, &stats);
+	assert(stats.nodes == 1 + 100 * 61);
+	assert(stats.bytes_used == sizeof(struct zz_node) + 100 * tree_bytes(30));
+	zz_tree_destroy_parallel(&copy, 4);
+	zz_tree_destroy(&tree);
+
+	/* Concurrent trees account for sizes too */
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_set_token_size(&tree, TOK_FUNC, sizeof(struct func_node));
+	zz_tree_set_concurrent(&tree, 1);
+	zz_node(&tree, TOK_FUNC, zz_null);
+	zz_node(&tree, TOK_NUM, zz_null);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.bytes_used ==
+			sizeof(struct func_node) + sizeof(struct zz_node));
+	zz_tree_destroy(&tree);
+
+	/* Nodes keep the size they were created with when retokened */
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_set_token_size(&tree, TOK_FUNC, sizeof(struct func_node));
+	root = zz_node(&tree, TOK_NUM, zz_null);
+	root->token = TOK_FUNC;
+	assert(zz_tree_sizeof(&tree, root) == sizeof(struct zz_node));
+	zz_recycle(&tree, root);
+	func = zz_node(&tree, TOK_FUNC, zz_null);
+	memset(((struct func_node *)func)->scope, 'x', 200);
+	assert(zz_tree_sizeof(&tree, func) == sizeof(struct func_node));
+	func->token = TOK_NUM;
+	zz_recycle(&tree, func);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.bytes_allocated ==
+			sizeof(struct func_node) + sizeof(struct zz_node));
+	assert(zz_node(&tree, TOK_NUM, zz_null) == root);
+	/* but zz_set_token() refuses to make them smaller than their token */
+	assert(zz_set_token(&tree, root, TOK_FUNC) == -1);
+	assert(root->token == TOK_NUM);
+	func = zz_node(&tree, TOK_FUNC, zz_null);
+	assert(zz_set_token(&tree, func, TOK_NUM) == 0);
+	assert(zz_set_token(&tree, func, TOK_FUNC) == 0);
+	zz_tree_destroy(&tree);
+
+	exit(EXIT_SUCCESS);
+}
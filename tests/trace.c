@@ -0,0 +1,88 @@
+
+#include <assert.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+
+static const char *EVENTS[] = {
+	"node", "string_hit", "string_miss", "string_delete", "destroy",
+	"destroyed", "error"
+};
+
+static void hook(enum zz_event event, const void *ptr, size_t value, void *data)
+{
+	int *count = data;
+
+	assert(ptr != NULL);
+	printf("%s %zu\n", EVENTS[event], event == ZZ_EVENT_NODE ? 0 : value);
+	++*count;
+}
+
+static int data_a, data_b;
+
+static void hook_a(enum zz_event event, const void *ptr, size_t value,
+		void *data)
+{
+	assert(data == &data_a);
+}
+
+static void hook_b(enum zz_event event, const void *ptr, size_t value,
+		void *data)
+{
+	assert(data == &data_b);
+}
+
+static void *create_nodes(void *arg)
+{
+	struct zz_tree tree;
+	int i;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	for (i = 0; i < 100000; ++i)
+		zz_node(&tree, TOK_FOO, zz_null);
+	zz_tree_destroy(&tree);
+	return NULL;
+}
+
+/* Hooks are always called with their own data while they are replaced */
+static void test_replace(void)
+{
+	pthread_t thread;
+	int i;
+
+	pthread_create(&thread, NULL, create_nodes, NULL);
+	for (i = 0; i < 10000; ++i)
+		zz_set_trace_hook(i % 2 ? hook_a : hook_b,
+				i % 2 ? &data_a : &data_b);
+	pthread_join(thread, NULL);
+	zz_set_trace_hook(NULL, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree;
+	struct zz_node *root;
+	int count = 0;
+
+	setvbuf(stdout, NULL, _IONBF, 0);
+	zz_set_trace_hook(hook, &count);
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	root = zz_node(&tree, TOK_FOO, zz_string("tracing"));
+	zz_append_child(root, zz_node(&tree, TOK_BAR, zz_string("tracing")));
+	zz_append_child(root, zz_node(&tree, TOK_BAR, zz_int(42)));
+	zz_tree_destroy(&tree);
+	zz_error("traced", NULL, 7, 1, 7, 1);
+
+	zz_set_trace_hook(NULL, NULL);
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_node(&tree, TOK_FOO, zz_null);
+	zz_tree_destroy(&tree);
+
+	assert(count == 10);
+
+	test_replace();
+	exit(EXIT_SUCCESS);
+}